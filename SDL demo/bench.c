@@ -0,0 +1,225 @@
+// Micro-benchmarks for the kernels in main.c, built as their own binary from
+// `SDL demo/`:
+//
+//     gcc -O2 bench.c -o solar-bench -lSDL3 -lsqlite3 -lm
+//
+// main.c is included whole so its static functions are reachable;
+// SOLAR_NO_MAIN leaves out its main(). Every benchmark runs a few warm-up
+// passes, then times repeated passes and reports the median and the
+// throughput in items per second.
+#define SOLAR_NO_MAIN
+// the app's own helpers are unused here
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "main.c"
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+#define MICRO_WARMUP 3
+#define MICRO_REPS 15
+#define MICRO_CATALOG_PATH "solar-bench-catalog.txt"
+
+typedef void (*MicroFn)(void *ctx, int items);
+
+typedef struct
+{
+    SDL_Renderer *renderer;
+    float *x, *z, *outX, *outY, *outDepth;
+    BodyStore store;
+    NameIndex names;
+    struct Moon *moons;
+} MicroContext;
+
+static volatile float microSink;
+
+static int CompareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void RunMicro(const char *name, MicroFn fn, void *ctx, int items)
+{
+    double ns[MICRO_REPS];
+    for (int i = 0; i < MICRO_WARMUP; i++)
+        fn(ctx, items);
+    for (int i = 0; i < MICRO_REPS; i++)
+    {
+        Uint64 start = SDL_GetTicksNS();
+        fn(ctx, items);
+        ns[i] = (double)(SDL_GetTicksNS() - start);
+    }
+    qsort(ns, MICRO_REPS, sizeof(double), CompareDouble);
+    double median = ns[MICRO_REPS / 2];
+    printf("%-32s %9d items %10.3f ms (min %.3f) %14.0f items/s\n", name, items, median / 1e6,
+           ns[0] / 1e6, median > 0.0 ? items / (median / 1e9) : 0.0);
+    fflush(stdout);
+}
+
+static void MicroProject(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    for (int i = 0; i < items; i++)
+        ProjectXZ3D(ctx->x[i], ctx->z[i], 0.87f, 0.48f, 0.88f, 0.48f, 1500.0f, 560.0f, 800.0f, 500.0f,
+                    0.0f, 0.0f, &ctx->outX[i], &ctx->outY[i], &ctx->outDepth[i]);
+    microSink += ctx->outX[items - 1];
+}
+
+static void MicroProjectBatch(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    ProjectXZ3DBatch(items, ctx->x, ctx->z, sizeof(float), 0.87f, 0.48f, 0.88f, 0.48f, 1500.0f, 560.0f,
+                     800.0f, 500.0f, 0.0f, 0.0f, ctx->outX, ctx->outY, ctx->outDepth, sizeof(float));
+    microSink += ctx->outX[items - 1];
+}
+
+static void MicroFillCircle(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    for (int i = 0; i < items; i++)
+        DrawFillCircle(ctx->renderer, (float)(i % WIDTH), (float)(i % HEIGHT), 8.0f);
+}
+
+static void MicroCircle(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    for (int i = 0; i < items; i++)
+        DrawCircle(ctx->renderer, (float)(i % WIDTH), (float)(i % HEIGHT), 8.0f);
+}
+
+// items are characters
+static void MicroText(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    static const char text[] = "PLANET 1234";
+    int len = (int)strlen(text);
+    for (int i = 0; i < items / len; i++)
+        DrawText(ctx->renderer, (float)(i % WIDTH), (float)(i % HEIGHT), text, 2.0f);
+}
+
+static void MicroOcclusion(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    float sum = 0.0f;
+    for (int i = 0; i < items; i++)
+        sum += SmoothOcclusionAlpha(ctx->x[i] * 0.05f, ctx->z[i] * 0.05f, 8.0f, 0.0f, 0.0f, 30.0f);
+    microSink += sum;
+}
+
+static void MicroLoadText(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    if (LoadPlanetsFromTextFile(MICRO_CATALOG_PATH, &ctx->store) != 1 || ctx->store.count != items)
+        fprintf(stderr, "Loaded %d of %d bodies\n", ctx->store.count, items);
+}
+
+static void MicroResolveLinear(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    ResolveMoonParents(ctx->moons, items, &ctx->store, NULL);
+}
+
+static void MicroResolveIndexed(void *data, int items)
+{
+    MicroContext *ctx = (MicroContext *)data;
+    ResolveMoonParents(ctx->moons, items, &ctx->store, &ctx->names);
+}
+
+static bool WriteMicroCatalog(int n)
+{
+    FILE *fp = fopen(MICRO_CATALOG_PATH, "w");
+    if (!fp)
+        return false;
+    for (int i = 0; i < n; i++)
+        fprintf(fp, "BODY%d %.3f %.5f %.3f %d %d %d\n", i, 60.0f + (i % 1200), 0.02f, 4.0f + (i % 8),
+                80 + i % 176, 120, 200);
+    return fclose(fp) == 0;
+}
+
+int main(void)
+{
+    if (!SDL_Init(SDL_INIT_EVENTS))
+    {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    MicroContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    BodyStoreInit(&ctx.store);
+    SDL_Surface *surface = SDL_CreateSurface(WIDTH, HEIGHT, SDL_PIXELFORMAT_XRGB8888);
+    ctx.renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    const int points = 1 << 20;
+    float *arrays = (float *)malloc(sizeof(float) * 5 * points);
+    if (!ctx.renderer || !arrays)
+    {
+        fprintf(stderr, "Benchmark setup failed: %s\n", SDL_GetError());
+        free(arrays);
+        SDL_DestroySurface(surface);
+        SDL_Quit();
+        return 1;
+    }
+    ctx.x = arrays;
+    ctx.z = ctx.x + points;
+    ctx.outX = ctx.z + points;
+    ctx.outY = ctx.outX + points;
+    ctx.outDepth = ctx.outY + points;
+    srand(42);
+    for (int i = 0; i < points; i++)
+    {
+        ctx.x[i] = (float)rand() / RAND_MAX * 2400.0f - 1200.0f;
+        ctx.z[i] = (float)rand() / RAND_MAX * 2400.0f - 1200.0f;
+    }
+    SDL_SetRenderDrawColor(ctx.renderer, 200, 200, 200, 255);
+
+    RunMicro("ProjectXZ3D", MicroProject, &ctx, points);
+    RunMicro("ProjectXZ3DBatch", MicroProjectBatch, &ctx, points);
+    RunMicro("SmoothOcclusionAlpha", MicroOcclusion, &ctx, points);
+    RunMicro("DrawFillCircle r8", MicroFillCircle, &ctx, 10000);
+    RunMicro("DrawCircle r8", MicroCircle, &ctx, 10000);
+    RunMicro("DrawText chars", MicroText, &ctx, 11000);
+
+    char name[64];
+    for (int n = 1000; n <= 1000000; n *= 10)
+    {
+        if (!WriteMicroCatalog(n))
+        {
+            fprintf(stderr, "Failed to write '%s'\n", MICRO_CATALOG_PATH);
+            break;
+        }
+        snprintf(name, sizeof(name), "LoadPlanetsFromTextFile %d", n);
+        RunMicro(name, MicroLoadText, &ctx, n);
+    }
+    remove(MICRO_CATALOG_PATH);
+
+    // moons look up parents spread over the whole last catalog, in an order
+    // where any prefix of them is spread too
+    const int numMoons = 1000;
+    ctx.moons = (struct Moon *)calloc(numMoons, sizeof(struct Moon));
+    if (ctx.moons && ctx.store.count > 0 && NameIndexBuild(&ctx.names, &ctx.store))
+    {
+        for (int i = 0; i < numMoons; i++)
+        {
+            int parent = (int)((Sint64)(i * 7919 % numMoons) * ctx.store.count / numMoons);
+            SDL_strlcpy(ctx.moons[i].parentName, ctx.store.bodies[parent].name,
+                        sizeof(ctx.moons[i].parentName));
+        }
+        // without the index every moon scans the store, so fewer of them
+        snprintf(name, sizeof(name), "ResolveMoonParents scan %d", ctx.store.count);
+        RunMicro(name, MicroResolveLinear, &ctx, numMoons / 100);
+        snprintf(name, sizeof(name), "ResolveMoonParents index %d", ctx.store.count);
+        RunMicro(name, MicroResolveIndexed, &ctx, numMoons);
+    }
+
+    free(ctx.moons);
+    NameIndexFree(&ctx.names);
+    BodyStoreFree(&ctx.store);
+    free(arrays);
+    SDL_DestroyRenderer(ctx.renderer);
+    SDL_DestroySurface(surface);
+    SDL_Quit();
+    return 0;
+}
@@ -4,6 +4,38 @@
 #include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <stdarg.h>
+#include "sqlite3.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#ifdef SOLAR_PROFILE
+#include <psapi.h>
+#endif
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <libgen.h>
+#include <sys/inotify.h>
+#ifdef SOLAR_PROFILE
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#endif
 
 #define WIDTH 1600
 #define HEIGHT 1000
@@ -12,6 +44,35 @@
 #define NUM_STARS 800
 #define HORIZONTAL_PITCH_LIMIT 0.6f
 
+// Profiling builds count every renderer call, per frame and per stage: the
+// SDL render functions are redirected to wrappers defined with the profiler.
+// A parenthesised name, as in (SDL_RenderPoint)(...), still reaches SDL.
+#ifdef SOLAR_PROFILE
+static bool CountedRenderClear(SDL_Renderer *renderer);
+static bool CountedRenderPoint(SDL_Renderer *renderer, float x, float y);
+static bool CountedRenderLine(SDL_Renderer *renderer, float x1, float y1, float x2, float y2);
+static bool CountedRenderRect(SDL_Renderer *renderer, const SDL_FRect *rect);
+static bool CountedRenderFillRect(SDL_Renderer *renderer, const SDL_FRect *rect);
+static bool CountedRenderFillRects(SDL_Renderer *renderer, const SDL_FRect *rects, int count);
+static bool CountedRenderTexture(SDL_Renderer *renderer, SDL_Texture *texture,
+                                 const SDL_FRect *src, const SDL_FRect *dst);
+static bool CountedSetRenderDrawColor(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+static bool CountedSetRenderDrawBlendMode(SDL_Renderer *renderer, SDL_BlendMode mode);
+static bool CountedSetRenderClipRect(SDL_Renderer *renderer, const SDL_Rect *rect);
+static bool CountedSetRenderTarget(SDL_Renderer *renderer, SDL_Texture *texture);
+#define SDL_RenderClear(...) CountedRenderClear(__VA_ARGS__)
+#define SDL_RenderPoint(...) CountedRenderPoint(__VA_ARGS__)
+#define SDL_RenderLine(...) CountedRenderLine(__VA_ARGS__)
+#define SDL_RenderRect(...) CountedRenderRect(__VA_ARGS__)
+#define SDL_RenderFillRect(...) CountedRenderFillRect(__VA_ARGS__)
+#define SDL_RenderFillRects(...) CountedRenderFillRects(__VA_ARGS__)
+#define SDL_RenderTexture(...) CountedRenderTexture(__VA_ARGS__)
+#define SDL_SetRenderDrawColor(...) CountedSetRenderDrawColor(__VA_ARGS__)
+#define SDL_SetRenderDrawBlendMode(...) CountedSetRenderDrawBlendMode(__VA_ARGS__)
+#define SDL_SetRenderClipRect(...) CountedSetRenderClipRect(__VA_ARGS__)
+#define SDL_SetRenderTarget(...) CountedSetRenderTarget(__VA_ARGS__)
+#endif
+
 struct Circle
 {
     float x;
@@ -29,16 +90,39 @@ typedef struct
     float worldX, worldZ;
     float depth;
     float screenRadius;
+    sqlite3_int64 catalogId; // row id in a SQLite catalog, 0 otherwise
+    bool marked;             // selected in the remove panel
     char name[64];
 } Planet;
 
+#define BODY_SLOT_NONE 0xFFFFFFFFu
+
+// generation 0 is never handed out, so a zeroed handle is always invalid
+typedef struct
+{
+    Uint32 slot;
+    Uint32 generation;
+} BodyHandle;
+
+typedef struct
+{
+    Planet *bodies;         // dense, iterate 0..count-1
+    Uint32 *denseSlot;      // dense index -> slot
+    Uint32 *slotDense;      // slot -> dense index, or next free slot
+    Uint32 *slotGeneration; // bumped every time a slot is freed
+    int count;
+    int capacity;
+    Uint32 slotCount;
+    Uint32 freeHead;
+} BodyStore;
+
 struct Moon
 {
     float x;
     float y;
     float radius;
     Uint8 r, g, b;
-    int parentIndex;
+    BodyHandle parent;
     char parentName[32];
     float orbitRadius;
     float angle;
@@ -115,7 +199,7 @@ void DrawCircle(SDL_Renderer *renderer, float cx, float cy, float radius)
     }
 }
 
-static const unsigned char font5x7[36][7] = {
+static const unsigned char font5x7[38][7] = {
     {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},
     {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
     {0x0E, 0x11, 0x01, 0x06, 0x08, 0x10, 0x1F},
@@ -154,7 +238,10 @@ static const unsigned char font5x7[36][7] = {
     {0x11, 0x11, 0x11, 0x15, 0x15, 0x1B, 0x11},
     {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11},
     {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04},
-    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}};
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F},
+
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}};
 
 static int FontIndexForChar(char c)
 {
@@ -164,6 +251,10 @@ static int FontIndexForChar(char c)
         return 10 + (c - 'A');
     if (c >= 'a' && c <= 'z')
         return 10 + (c - 'a');
+    if (c == '.')
+        return 36;
+    if (c == '-')
+        return 37;
     return -1;
 }
 static int CirclesOverlap(float x1, float y1, float r1,
@@ -238,326 +329,5704 @@ static void DrawText(SDL_Renderer *renderer, float x, float y, const char *text,
     }
 }
 
-static void ProjectXZ3D(
-    float worldX, float worldZ,
-    float cosYaw, float sinYaw,
-    float cosPitch, float sinPitch,
-    float camDist, float fov,
-    float cx, float cy,
-    float panX, float panY,
-    float *outX, float *outY, float *outDepth)
+// The lit pixels of a string merged into horizontal runs. They are rebuilt
+// only when the text changes, so drawing is one SDL_RenderFillRects call
+// instead of a fill per pixel. '\n' starts a new line.
+#define TEXT_RUN_MAX 256
+
+typedef struct
 {
-    float x1 = worldX * cosYaw + worldZ * sinYaw;
-    float z1 = -worldX * sinYaw + worldZ * cosYaw;
-    float y1 = 0.0f;
-    float y2 = y1 * cosPitch - z1 * sinPitch;
-    float z2 = y1 * sinPitch + z1 * cosPitch;
-    float x2 = x1;
-    float cz = z2 + camDist;
-    if (cz < 1.0f)
-        cz = 1.0f;
-    float inv = fov / cz;
-    *outX = cx + panX + x2 * inv;
-    *outY = cy + panY + y2 * inv;
-    if (outDepth)
-        *outDepth = cz;
-}
+    char text[TEXT_RUN_MAX];
+    float scale;
+    SDL_FRect *rects;  // relative to the top left of the text
+    SDL_FRect *placed; // rects moved to where the run is drawn
+    int count;
+    int capacity;
+    float width, height;
+} TextRun;
 
-static int LoadPlanetsFromTextFile(const char *filename,
-                                   Planet **outPlanets,
-                                   int *outCount)
+static bool TextRunSet(TextRun *run, const char *text, float scale)
 {
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
+    if (run->rects && run->scale == scale && strcmp(run->text, text) == 0)
+        return true;
+    int len = (int)strlen(text);
+    if (len >= TEXT_RUN_MAX)
+        len = TEXT_RUN_MAX - 1;
+    // at most three runs per glyph row
+    int worst = len * 7 * 3;
+    if (worst > run->capacity)
     {
-        fprintf(stderr, "Failed to open planets file '%s'\n", filename);
-        return 0;
+        SDL_FRect *rects = (SDL_FRect *)realloc(run->rects, sizeof(SDL_FRect) * worst);
+        if (!rects)
+            return false;
+        run->rects = rects;
+        SDL_FRect *placed = (SDL_FRect *)realloc(run->placed, sizeof(SDL_FRect) * worst);
+        if (!placed)
+            return false;
+        run->placed = placed;
+        run->capacity = worst;
     }
-    Planet *planets = NULL;
-    int count = 0;
-    char line[512];
+    memcpy(run->text, text, len);
+    run->text[len] = '\0';
+    run->scale = scale;
+    run->count = 0;
+    run->width = 0.0f;
 
-    while (fgets(line, sizeof(line), fp))
+    float cx = 0.0f;
+    float cy = 0.0f;
+    for (int i = 0; i < len; i++)
     {
-        if (line[0] == '#' || strlen(line) < 5)
-            continue;
-        char name[64];
-        float orbitRadius, angularSpeed, radius;
-        int r, g, b;
-        int n = sscanf(line, "%63s %f %f %f %d %d %d",
-                       name, &orbitRadius, &angularSpeed,
-                       &radius, &r, &g, &b);
-        if (n != 7)
+        if (text[i] == '\n')
+        {
+            cx = 0.0f;
+            cy += 10.0f * scale;
             continue;
-
-        Planet *tmp = (Planet *)realloc(planets, sizeof(Planet) * (count + 1));
-        if (!tmp)
+        }
+        int idx = FontIndexForChar(text[i]);
+        for (int row = 0; idx >= 0 && row < 7; ++row)
         {
-            fclose(fp);
-            free(planets);
-            return 0;
+            unsigned char bits = font5x7[idx][row];
+            int col = 0;
+            while (col < 5)
+            {
+                if (!(bits & (1 << (4 - col))))
+                {
+                    col++;
+                    continue;
+                }
+                int start = col;
+                while (col < 5 && (bits & (1 << (4 - col))))
+                    col++;
+                SDL_FRect r = {cx + start * scale, cy + row * scale, (col - start) * scale, scale};
+                run->rects[run->count++] = r;
+            }
         }
-        planets = tmp;
-        Planet *p = &planets[count];
-        memset(p, 0, sizeof(*p));
-        strncpy(p->name, name, sizeof(p->name) - 1);
-        p->orbitRadius = orbitRadius;
-        p->angularSpeed = angularSpeed;
-        p->angle = 0.0f;
-        p->circle.radius = radius;
-        p->circle.r = (Uint8)r;
-        p->circle.g = (Uint8)g;
-        p->circle.b = (Uint8)b;
-        p->worldX = 0.0f;
-        p->worldZ = p->orbitRadius;
-        p->depth = 1.0f;
-        p->screenRadius = 0.0f;
-        count++;
+        cx += 6.0f * scale;
+        if (cx - scale > run->width)
+            run->width = cx - scale;
     }
-    fclose(fp);
-    *outPlanets = planets;
-    *outCount = count;
-    printf("Loaded %d planets from '%s'\n", count, filename);
-    return (count > 0);
+    run->height = cy + 7.0f * scale;
+    return true;
 }
 
-static void ResolveMoonParents(struct Moon *moons,
-                               int numMoons,
-                               Planet *planets,
-                               int numPlanets)
+static void DrawTextRun(SDL_Renderer *renderer, TextRun *run, float x, float y)
 {
-    for (int i = 0; i < numMoons; i++)
+    for (int i = 0; i < run->count; i++)
     {
-        moons[i].parentIndex = -1;
-        for (int p = 0; p < numPlanets; p++)
-        {
-            if (strcmp(moons[i].parentName, planets[p].name) == 0)
-            {
-                moons[i].parentIndex = p;
-                break;
-            }
-        }
+        run->placed[i] = run->rects[i];
+        run->placed[i].x += x;
+        run->placed[i].y += y;
     }
+    if (run->count > 0)
+        SDL_RenderFillRects(renderer, run->placed, run->count);
 }
 
-static void ClampColorInt(int *v)
+static void TextRunFree(TextRun *run)
 {
-    if (*v < 0)
-        *v = 0;
-    if (*v > 255)
-        *v = 255;
+    free(run->rects);
+    free(run->placed);
+    memset(run, 0, sizeof(*run));
 }
 
-static int SavePlanetFromFieldsToFile(const char *filename, TextField fields[FIELD_COUNT])
+// Per-stage frame timings, built only with -DSOLAR_PROFILE; otherwise the
+// PROFILE_* macros expand to nothing. The main thread fills one record per
+// frame and publishes it into a ring that readers copy without locking.
+#ifdef SOLAR_PROFILE
+#define PROFILE_RING 1024 // frames, a power of two
+#define PROFILE_REPORT_FRAMES 300
+
+typedef enum
 {
-    const char *name = fields[FIELD_NAME].text;
-    const char *orbitS = fields[FIELD_ORBIT].text;
-    const char *speedS = fields[FIELD_SPEED].text;
-    const char *radS = fields[FIELD_RADIUS].text;
-    const char *rS = fields[FIELD_R].text;
-    const char *gS = fields[FIELD_G].text;
-    const char *bS = fields[FIELD_B].text;
+    STAGE_EVENTS = 0,
+    STAGE_UPDATE,
+    STAGE_PROJECT,
+    STAGE_STARS,
+    STAGE_ORBITS,
+    STAGE_ASTEROIDS,
+    STAGE_BODIES,
+    STAGE_UI,
+    STAGE_PRESENT,
+    STAGE_COUNT
+} ProfileStage;
 
-    if (name[0] == '\0')
-    {
-        fprintf(stderr, "Name cannot be empty.\n");
-        return 0;
-    }
+static const char *const profileStageNames[STAGE_COUNT + 1] = {
+    "events", "update", "project", "stars", "orbits",
+    "asteroids", "bodies", "ui", "present", "frame"};
 
-    float orbitRadius = (float)atof(orbitS);
-    float angularSpeed = (float)atof(speedS);
-    float radius = (float)atof(radS);
-    int r = atoi(rS);
-    int g = atoi(gS);
-    int b = atoi(bS);
-    ClampColorInt(&r);
-    ClampColorInt(&g);
-    ClampColorInt(&b);
+// hardware counters read around each stage with --perf-counters, Linux only
+typedef enum
+{
+    HW_CYCLES = 0,
+    HW_INSTRUCTIONS,
+    HW_CACHE_MISSES,
+    HW_BRANCH_MISSES,
+    HW_COUNT
+} HwCounter;
 
-    FILE *fp = fopen(filename, "a");
-    if (!fp)
+static const char *const hwCounterNames[HW_COUNT] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"};
+
+typedef struct
+{
+    Uint32 drawCalls;
+    Uint32 primitives;   // points, lines and rects; a texture copy is one
+    Uint32 colorCalls;   // SDL_SetRenderDrawColor calls
+    Uint32 stateChanges; // colours that differ from the last one, blend, clip and target
+} RenderCounts;
+
+typedef struct
+{
+    Uint64 frame;
+    Uint64 startNs;
+    Uint64 ns[STAGE_COUNT + 1];             // the last slot is the whole frame
+    RenderCounts render[STAGE_COUNT + 1]; // likewise
+    Uint64 hw[STAGE_COUNT + 1][HW_COUNT];  // likewise; zero without --perf-counters
+    Uint32 bodiesSimulated;
+    Uint32 bodiesDrawn;
+} FrameRecord;
+
+typedef struct
+{
+    FrameRecord ring[PROFILE_RING];
+    SDL_AtomicU32 head; // records published so far
+    FrameRecord current;
+    Uint64 stageStart[STAGE_COUNT];
+    Uint64 frameStart;
+    double nsPerTick;
+    ProfileStage stage; // the open stage, STAGE_COUNT between stages
+    Uint32 color;       // last draw colour, packed
+    bool colorSet;
+    int hwFd[HW_COUNT]; // perf event group led by hwFd[0], -1 when counters are off
+    Uint64 hwStageStart[STAGE_COUNT][HW_COUNT];
+    Uint64 hwFrameStart[HW_COUNT];
+} Profiler;
+
+typedef struct
+{
+    double min, mean, p50, p99; // milliseconds
+} StageStats;
+
+static Profiler profiler = {.hwFd = {-1, -1, -1, -1}};
+
+// Chrome trace-event export, started with --trace <file>. Each thread records
+// complete events into its own buffer without locking; a full buffer is
+// formatted into the file under the tracer's lock, so recording costs a
+// clock read and a store. Open the file in chrome://tracing or Perfetto.
+#define TRACE_BUFFER_EVENTS 4096
+
+typedef struct
+{
+    const char *name; // a string literal
+    Uint64 startNs;
+    Uint64 durNs;
+} TraceEvent;
+
+typedef struct TraceBuffer
+{
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+    int count;
+    SDL_ThreadID tid;
+    const char *threadName;
+    bool named;  // thread_name record written
+    bool active; // owned by a running thread
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+typedef struct
+{
+    FILE *fp;
+    SDL_Mutex *lock;
+    SDL_TLSID tls;
+    TraceBuffer *buffers; // reused once their thread exits
+    SDL_AtomicInt enabled;
+    Uint64 originNs;
+    bool first;
+} Tracer;
+
+static Tracer tracer;
+
+static void TraceFlushLocked(TraceBuffer *buf)
+{
+    if (buf->threadName && !buf->named)
     {
-        fprintf(stderr, "Failed to open '%s' for appending.\n", filename);
-        return 0;
+        fprintf(tracer.fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%llu,"
+                           "\"args\":{\"name\":\"%s\"}}",
+                tracer.first ? "" : ",", (unsigned long long)buf->tid, buf->threadName);
+        tracer.first = false;
+        buf->named = true;
     }
-    fprintf(fp, "%s %.3f %.5f %.3f %d %d %d\n",
-            name, orbitRadius, angularSpeed, radius, r, g, b);
-    fclose(fp);
-    printf("Added planet: %s\n", name);
-    return 1;
+    for (int i = 0; i < buf->count; i++)
+    {
+        const TraceEvent *ev = &buf->events[i];
+        fprintf(tracer.fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,"
+                           "\"ts\":%.3f,\"dur\":%.3f}",
+                tracer.first ? "" : ",", ev->name, (unsigned long long)buf->tid,
+                (double)(Sint64)(ev->startNs - tracer.originNs) / 1000.0, ev->durNs / 1000.0);
+        tracer.first = false;
+    }
+    buf->count = 0;
 }
 
-static int RemovePlanetAtIndexInFile(const char *filename,
-                                     Planet *planets, int numPlanets,
-                                     int removeIndex)
+static void SDLCALL TraceThreadExit(void *value)
 {
-    if (removeIndex < 0 || removeIndex >= numPlanets)
-        return 0;
+    TraceBuffer *buf = (TraceBuffer *)value;
+    SDL_LockMutex(tracer.lock);
+    if (tracer.fp)
+        TraceFlushLocked(buf);
+    buf->active = false;
+    SDL_UnlockMutex(tracer.lock);
+}
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp)
+static TraceBuffer *TraceThreadBuffer(void)
+{
+    TraceBuffer *buf = (TraceBuffer *)SDL_GetTLS(&tracer.tls);
+    if (buf)
+        return buf;
+    SDL_LockMutex(tracer.lock);
+    for (buf = tracer.buffers; buf && buf->active; buf = buf->next)
     {
-        fprintf(stderr, "Failed to open '%s' for rewrite.\n", filename);
-        return 0;
     }
-    for (int i = 0; i < numPlanets; i++)
+    if (!buf && (buf = (TraceBuffer *)malloc(sizeof(TraceBuffer))) != NULL)
     {
-        if (i == removeIndex)
-            continue;
-        Planet *p = &planets[i];
-        fprintf(fp, "%s %.3f %.5f %.3f %d %d %d\n",
-                p->name,
-                p->orbitRadius,
-                p->angularSpeed,
-                p->circle.radius,
-                p->circle.r,
-                p->circle.g,
-                p->circle.b);
+        buf->next = tracer.buffers;
+        tracer.buffers = buf;
     }
-    fclose(fp);
-    printf("Removed planet: %s\n", planets[removeIndex].name);
-    return 1;
+    if (buf)
+    {
+        buf->count = 0;
+        buf->tid = SDL_GetCurrentThreadID();
+        buf->threadName = NULL;
+        buf->named = false;
+        buf->active = true;
+    }
+    SDL_UnlockMutex(tracer.lock);
+    if (buf && !SDL_SetTLS(&tracer.tls, buf, TraceThreadExit))
+    {
+        SDL_LockMutex(tracer.lock);
+        buf->active = false;
+        SDL_UnlockMutex(tracer.lock);
+        buf = NULL;
+    }
+    return buf;
 }
 
-static bool PointInRect(float x, float y, const SDL_FRect *rect)
+static void TraceSpan(const char *name, Uint64 startNs, Uint64 durNs)
 {
-    return (x >= rect->x && x <= rect->x + rect->w &&
-            y >= rect->y && y <= rect->y + rect->h);
+    if (!SDL_GetAtomicInt(&tracer.enabled))
+        return;
+    TraceBuffer *buf = TraceThreadBuffer();
+    if (!buf)
+        return;
+    if (buf->count == TRACE_BUFFER_EVENTS)
+    {
+        SDL_LockMutex(tracer.lock);
+        if (tracer.fp)
+            TraceFlushLocked(buf);
+        buf->count = 0;
+        SDL_UnlockMutex(tracer.lock);
+    }
+    TraceEvent *ev = &buf->events[buf->count++];
+    ev->name = name;
+    ev->startNs = startNs;
+    ev->durNs = durNs;
 }
 
-int main(int argc, char *argv[])
+static void TraceEnd(const char *name, Uint64 startNs)
+{
+    if (SDL_GetAtomicInt(&tracer.enabled))
+        TraceSpan(name, startNs, SDL_GetTicksNS() - startNs);
+}
+
+static void TraceThreadName(const char *name)
 {
-    if (!SDL_Init(SDL_INIT_VIDEO))
+    if (!SDL_GetAtomicInt(&tracer.enabled))
+        return;
+    TraceBuffer *buf = TraceThreadBuffer();
+    if (buf)
+        buf->threadName = name;
+}
+
+static bool TraceStart(const char *path)
+{
+    tracer.lock = SDL_CreateMutex();
+    tracer.fp = tracer.lock ? fopen(path, "w") : NULL;
+    if (!tracer.fp)
     {
-        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
-        return 1;
+        fprintf(stderr, "Failed to open trace file '%s'\n", path);
+        if (tracer.lock)
+            SDL_DestroyMutex(tracer.lock);
+        tracer.lock = NULL;
+        return false;
     }
+    setvbuf(tracer.fp, NULL, _IOFBF, 1 << 20);
+    fprintf(tracer.fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    tracer.first = true;
+    tracer.originNs = SDL_GetTicksNS();
+    SDL_SetAtomicInt(&tracer.enabled, 1);
+    return true;
+}
 
-    SDL_Window *window = SDL_CreateWindow(
-        "3D-ish Solar System (Add/Remove + Stars)",
-        WIDTH, HEIGHT,
-        SDL_WINDOW_RESIZABLE);
-    if (!window)
+// every other thread that recorded has exited by now
+static void TraceStop(void)
+{
+    if (!tracer.fp)
+        return;
+    SDL_SetAtomicInt(&tracer.enabled, 0);
+    SDL_SetTLS(&tracer.tls, NULL, NULL);
+    SDL_LockMutex(tracer.lock);
+    for (TraceBuffer *buf = tracer.buffers; buf; buf = buf->next)
+        TraceFlushLocked(buf);
+    fprintf(tracer.fp, "\n]}\n");
+    if (fclose(tracer.fp) != 0)
+        fprintf(stderr, "Failed to write trace file\n");
+    tracer.fp = NULL;
+    SDL_UnlockMutex(tracer.lock);
+    while (tracer.buffers)
     {
-        fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
-        SDL_Quit();
-        return 1;
+        TraceBuffer *next = tracer.buffers->next;
+        free(tracer.buffers);
+        tracer.buffers = next;
     }
+    SDL_DestroyMutex(tracer.lock);
+    tracer.lock = NULL;
+}
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, NULL);
-    if (!renderer)
+// The four counters are opened as one perf event group on the calling thread,
+// user space only, so a single read() returns all of them. Each stage boundary
+// then costs a system call, which is why the counters are opt-in.
+static bool HwCountersStart(void)
+{
+#ifdef __linux__
+    static const Uint64 configs[HW_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    int fds[HW_COUNT];
+    for (int i = 0; i < HW_COUNT; i++)
     {
-        fprintf(stderr, "SDL_CreateRenderer failed: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return 1;
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0UL);
+        if (fds[i] < 0)
+        {
+            fprintf(stderr, "perf_event_open failed for %s: %s; hardware counters are off\n",
+                    hwCounterNames[i], strerror(errno));
+            while (i-- > 0)
+                close(fds[i]);
+            return false;
+        }
     }
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    memcpy(profiler.hwFd, fds, sizeof(fds));
+    return true;
+#else
+    fprintf(stderr, "Hardware counters are only available on Linux.\n");
+    return false;
+#endif
+}
 
-    const char *PLANETS_FILE = "planets.txt";
-
-    Planet *planets = NULL;
-    int numPlanets = 0;
-    if (!LoadPlanetsFromTextFile(PLANETS_FILE, &planets, &numPlanets) || numPlanets == 0)
+static void HwCountersStop(void)
+{
+#ifdef __linux__
+    if (profiler.hwFd[0] < 0)
+        return;
+    ioctl(profiler.hwFd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    for (int i = HW_COUNT - 1; i >= 0; i--)
     {
-        fprintf(stderr, "No planets loaded. Ensure 'planets.txt' exists.\n");
-        SDL_DestroyRenderer(renderer);
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return 1;
+        close(profiler.hwFd[i]);
+        profiler.hwFd[i] = -1;
     }
+#endif
+}
 
-    const float BASE_FOV = 800.0f;
-    const float CAM_DIST = 1500.0f;
-    float zoom = 0.7f;
-    float camYaw = 0.5f;
-    float camPitch = 0.5f;
-    float camPanX = 0.0f;
-    float camPanY = 0.0f;
-    const float ROTATE_SENS = 0.005f;
-    const float PAN_SENS = 1.0f;
+// leaves values alone if the read fails, so the next delta is zero
+static void HwCountersRead(Uint64 values[HW_COUNT])
+{
+#ifdef __linux__
+    struct
+    {
+        Uint64 nr;
+        Uint64 values[HW_COUNT];
+    } group;
+    if (read(profiler.hwFd[0], &group, sizeof(group)) == (ssize_t)sizeof(group))
+        memcpy(values, group.values, sizeof(group.values));
+#else
+    (void)values;
+#endif
+}
 
-    int mouseLeft = 0, mouseRight = 0;
-    int lastX = 0, lastY = 0;
+static void HwCountersAdd(Uint64 total[HW_COUNT], const Uint64 start[HW_COUNT])
+{
+    Uint64 now[HW_COUNT];
+    memcpy(now, start, sizeof(now));
+    HwCountersRead(now);
+    for (int i = 0; i < HW_COUNT; i++)
+        total[i] += now[i] - start[i];
+}
 
-    srand(42);
+static void ProfileFrameBegin(void)
+{
+    if (profiler.nsPerTick == 0.0)
+        profiler.nsPerTick = 1e9 / (double)SDL_GetPerformanceFrequency();
+    profiler.frameStart = SDL_GetPerformanceCounter();
+    profiler.current.startNs = SDL_GetTicksNS();
+    profiler.stage = STAGE_COUNT;
+    if (profiler.hwFd[0] >= 0)
+        HwCountersRead(profiler.hwFrameStart);
+}
 
-    struct Circle sun = {0, 0, 30, 255, 255, 0};
-    float sunScreenX = 0, sunScreenY = 0, sunDepth = 1, sunScreenRadius = 1;
+// the counters are read outside the timed span so their cost stays out of it
+static void ProfileBegin(ProfileStage stage)
+{
+    profiler.stage = stage;
+    if (profiler.hwFd[0] >= 0)
+        HwCountersRead(profiler.hwStageStart[stage]);
+    profiler.stageStart[stage] = SDL_GetPerformanceCounter();
+}
 
-    float innerBelt = 170.0f;
-    float outerBelt = 230.0f;
-    float asteroid_radius[NUM_ASTEROIDS];
-    float asteroid_angle[NUM_ASTEROIDS];
-    float asteroid_speed[NUM_ASTEROIDS];
+// stages may be entered more than once a frame; the times add up
+static void ProfileEnd(ProfileStage stage)
+{
+    Uint64 ticks = SDL_GetPerformanceCounter() - profiler.stageStart[stage];
+    Uint64 ns = (Uint64)(ticks * profiler.nsPerTick);
+    if (profiler.hwFd[0] >= 0)
+        HwCountersAdd(profiler.current.hw[stage], profiler.hwStageStart[stage]);
+    profiler.current.ns[stage] += ns;
+    profiler.stage = STAGE_COUNT;
+    if (SDL_GetAtomicInt(&tracer.enabled))
+        TraceSpan(profileStageNames[stage], SDL_GetTicksNS() - ns, ns);
+}
+
+static void ProfileFrameEnd(void)
+{
+    Uint64 ticks = SDL_GetPerformanceCounter() - profiler.frameStart;
+    if (profiler.hwFd[0] >= 0)
+        HwCountersAdd(profiler.current.hw[STAGE_COUNT], profiler.hwFrameStart);
+    Uint32 head = SDL_GetAtomicU32(&profiler.head);
+    profiler.current.frame = head;
+    profiler.current.ns[STAGE_COUNT] = (Uint64)(ticks * profiler.nsPerTick);
+    TraceSpan("frame", profiler.current.startNs, profiler.current.ns[STAGE_COUNT]);
+    profiler.ring[head & (PROFILE_RING - 1)] = profiler.current;
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&profiler.head, head + 1);
+    memset(&profiler.current, 0, sizeof(profiler.current));
+}
 
-    for (int i = 0; i < NUM_ASTEROIDS; i++)
+// adds to the open stage and to the frame total
+static void CountRender(Uint32 drawCalls, Uint32 primitives, Uint32 colorCalls, Uint32 stateChanges)
+{
+    RenderCounts *slots[2] = {&profiler.current.render[STAGE_COUNT], NULL};
+    if (profiler.stage != STAGE_COUNT)
+        slots[1] = &profiler.current.render[profiler.stage];
+    for (int i = 0; i < 2 && slots[i]; i++)
     {
-        asteroid_radius[i] = innerBelt + (float)rand() / RAND_MAX * (outerBelt - innerBelt);
-        asteroid_angle[i] = (float)rand() / RAND_MAX * 6.283185f;
-        asteroid_speed[i] = 0.01f + (float)rand() / RAND_MAX * 0.005f;
+        slots[i]->drawCalls += drawCalls;
+        slots[i]->primitives += primitives;
+        slots[i]->colorCalls += colorCalls;
+        slots[i]->stateChanges += stateChanges;
     }
+}
 
-    struct Moon moons[NUM_MOONS] = {
-        {0, 0, 3, 210, 210, 210, -1, "Earth", 18, 0, 0.08f},
-        {0, 0, 2, 200, 200, 200, -1, "Mars", 10, 1, 0.10f},
-        {0, 0, 2, 160, 160, 160, -1, "Mars", 15, 2, 0.07f},
-        {0, 0, 4, 255, 200, 180, -1, "Jupiter", 30, 0, 0.09f},
-        {0, 0, 3, 180, 220, 255, -1, "Jupiter", 40, 1, 0.07f},
-        {0, 0, 5, 220, 220, 220, -1, "Jupiter", 52, 2, 0.05f},
-        {0, 0, 4, 200, 200, 200, -1, "Jupiter", 65, 3, 0.04f},
-        {0, 0, 4, 230, 210, 160, -1, "Saturn", 28, 0.5f, 0.06f},
-        {0, 0, 3, 200, 220, 255, -1, "Uranus", 24, 1.2f, 0.06f},
-        {0, 0, 3, 180, 200, 255, -1, "Neptune", 22, 2.0f, 0.06f}};
-    float moonDepth[NUM_MOONS];
-    ResolveMoonParents(moons, NUM_MOONS, planets, numPlanets);
+static bool CountedRenderClear(SDL_Renderer *renderer)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderClear)(renderer);
+}
 
-    int selectedPlanet = -1;
-    SDL_Event e;
-    int running = 1;
+static bool CountedRenderPoint(SDL_Renderer *renderer, float x, float y)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderPoint)(renderer, x, y);
+}
 
-    SDL_FRect addButton = {10.0f, 10.0f, 160.0f, 40.0f};
-    SDL_FRect removeButton = {180.0f, 10.0f, 180.0f, 40.0f};
+static bool CountedRenderLine(SDL_Renderer *renderer, float x1, float y1, float x2, float y2)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderLine)(renderer, x1, y1, x2, y2);
+}
 
-    bool addPanelOpen = false;
-    FieldId activeField = FIELD_NAME;
-    TextField fields[FIELD_COUNT] = {
-        {"NAME", "", 32, false},
-        {"ORBIT", "", 16, true},
-        {"SPEED", "", 16, true},
-        {"RADIUS", "", 16, true},
-        {"COLOR R", "", 4, true},
-        {"COLOR G", "", 4, true},
-        {"COLOR B", "", 4, true}};
-    strcpy(fields[FIELD_R].text, "200");
-    strcpy(fields[FIELD_G].text, "200");
-    strcpy(fields[FIELD_B].text, "200");
+static bool CountedRenderRect(SDL_Renderer *renderer, const SDL_FRect *rect)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderRect)(renderer, rect);
+}
 
-    bool removePanelOpen = false;
-    bool removeConfirmOpen = false;
-    int removeCandidateIdx = -1;
+static bool CountedRenderFillRect(SDL_Renderer *renderer, const SDL_FRect *rect)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderFillRect)(renderer, rect);
+}
 
-    float starX[NUM_STARS];
-    float starY[NUM_STARS];
-    Uint8 starBrightness[NUM_STARS];
-    for (int i = 0; i < NUM_STARS; i++)
-    {
-        starX[i] = (float)(rand() % WIDTH);
-        starY[i] = (float)(rand() % HEIGHT);
-        starBrightness[i] = 120 + (rand() % 136);
-    }
+static bool CountedRenderFillRects(SDL_Renderer *renderer, const SDL_FRect *rects, int count)
+{
+    CountRender(1, count > 0 ? (Uint32)count : 0, 0, 0);
+    return (SDL_RenderFillRects)(renderer, rects, count);
+}
 
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+static bool CountedRenderTexture(SDL_Renderer *renderer, SDL_Texture *texture,
+                                 const SDL_FRect *src, const SDL_FRect *dst)
+{
+    CountRender(1, 1, 0, 0);
+    return (SDL_RenderTexture)(renderer, texture, src, dst);
+}
 
-    while (running)
-    {
-        while (SDL_PollEvent(&e))
-        {
-            if (e.type == SDL_EVENT_QUIT)
-            {
-                running = 0;
-            }
-            else if (!addPanelOpen && !removePanelOpen &&
-                     e.type == SDL_EVENT_MOUSE_WHEEL)
+static bool CountedSetRenderDrawColor(SDL_Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    Uint32 color = ((Uint32)r << 24) | ((Uint32)g << 16) | ((Uint32)b << 8) | a;
+    bool changed = !profiler.colorSet || color != profiler.color;
+    profiler.color = color;
+    profiler.colorSet = true;
+    CountRender(0, 0, 1, changed ? 1 : 0);
+    return (SDL_SetRenderDrawColor)(renderer, r, g, b, a);
+}
+
+static bool CountedSetRenderDrawBlendMode(SDL_Renderer *renderer, SDL_BlendMode mode)
+{
+    CountRender(0, 0, 0, 1);
+    return (SDL_SetRenderDrawBlendMode)(renderer, mode);
+}
+
+static bool CountedSetRenderClipRect(SDL_Renderer *renderer, const SDL_Rect *rect)
+{
+    CountRender(0, 0, 0, 1);
+    return (SDL_SetRenderClipRect)(renderer, rect);
+}
+
+static bool CountedSetRenderTarget(SDL_Renderer *renderer, SDL_Texture *texture)
+{
+    CountRender(0, 0, 0, 1);
+    return (SDL_SetRenderTarget)(renderer, texture);
+}
+
+// copies up to window of the newest records, oldest first; safe from any
+// thread while the main thread keeps publishing
+static int ProfileCollect(FrameRecord *out, int window)
+{
+    if (window > PROFILE_RING)
+        window = PROFILE_RING;
+    Uint32 head = SDL_GetAtomicU32(&profiler.head);
+    SDL_MemoryBarrierAcquire();
+    int n = head < (Uint32)window ? (int)head : window;
+    for (int i = 0; i < n; i++)
+        out[i] = profiler.ring[(head - n + i) & (PROFILE_RING - 1)];
+    SDL_MemoryBarrierAcquire();
+    // the writer may have lapped the oldest copies, including the one it is
+    // writing now
+    Uint32 written = SDL_GetAtomicU32(&profiler.head) - head + 1;
+    int stale = (int)written - (PROFILE_RING - n);
+    if (stale <= 0)
+        return n;
+    if (stale >= n)
+        return 0;
+    memmove(out, out + stale, sizeof(FrameRecord) * (n - stale));
+    return n - stale;
+}
+
+static int CompareUint64(const void *a, const void *b)
+{
+    Uint64 x = *(const Uint64 *)a;
+    Uint64 y = *(const Uint64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+// the per-frame sum of the stages in stageMask; bit STAGE_COUNT is the
+// whole frame
+static StageStats ProfileGroupStats(const FrameRecord *records, int n, Uint32 stageMask)
+{
+    StageStats st = {0.0, 0.0, 0.0, 0.0};
+    if (n <= 0)
+        return st;
+    Uint64 values[PROFILE_RING];
+    Uint64 sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = 0;
+        for (int s = 0; s <= STAGE_COUNT; s++)
+        {
+            if (stageMask & (1u << s))
+                values[i] += records[i].ns[s];
+        }
+        sum += values[i];
+    }
+    qsort(values, n, sizeof(Uint64), CompareUint64);
+    st.min = values[0] / 1e6;
+    st.mean = (double)sum / n / 1e6;
+    st.p50 = values[(n - 1) / 2] / 1e6;
+    st.p99 = values[(int)((n - 1) * 0.99)] / 1e6;
+    return st;
+}
+
+// stage STAGE_COUNT is the whole frame
+static StageStats ProfileStageStats(const FrameRecord *records, int n, int stage)
+{
+    return ProfileGroupStats(records, n, 1u << stage);
+}
+
+static void ProfileReport(void)
+{
+    static FrameRecord records[PROFILE_REPORT_FRAMES];
+    if (SDL_GetAtomicU32(&profiler.head) % PROFILE_REPORT_FRAMES != 0)
+        return;
+    int n = ProfileCollect(records, PROFILE_REPORT_FRAMES);
+    printf("Profile over %d frames (ms)    min    mean     p50     p99\n", n);
+    for (int s = 0; s <= STAGE_COUNT; s++)
+    {
+        StageStats st = ProfileStageStats(records, n, s);
+        printf("  %-26s %7.3f %7.3f %7.3f %7.3f\n", profileStageNames[s], st.min, st.mean, st.p50, st.p99);
+    }
+}
+
+// The on-screen side of the profiler, toggled with F3: frame rate, frame time
+// percentiles and a history graph, mean time per stage, body counts and
+// resident memory. The graph and stage bars are one SDL_RenderFillRects each
+// and the numbers are text runs rebuilt a few times a second.
+#define HUD_HISTORY 240 // frames in the graph, one pixel each
+#define HUD_TEXT_FRAMES 20
+#define HUD_BUDGET_MS 16.7
+#define HUD_GRAPH_H 60.0f
+#define HUD_BAR_W 100.0f
+#define HUD_SCALE 1.5f
+
+typedef struct
+{
+    bool visible;
+    Uint32 textFrame; // head when the text was last rebuilt
+    TextRun summary;
+    TextRun stages;
+    FrameRecord records[HUD_HISTORY];
+    SDL_FRect fast[HUD_HISTORY]; // frames within budget
+    SDL_FRect slow[HUD_HISTORY];
+    SDL_FRect stageBars[STAGE_COUNT];
+} PerfHud;
+
+// resident set size in bytes, 0 where it cannot be read
+static Uint64 ProcessMemoryBytes(void)
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int got = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return got == 2 ? (Uint64)resident * (Uint64)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+static bool PerfHudUpdateText(PerfHud *hud, int n)
+{
+    if (n <= 0)
+        return false;
+    StageStats frame = ProfileStageStats(hud->records, n, STAGE_COUNT);
+    const FrameRecord *last = &hud->records[n - 1];
+    double seconds = (last->startNs - hud->records[0].startNs) / 1e9;
+    double fps = n > 1 && seconds > 0.0 ? (n - 1) / seconds : 0.0;
+    Uint64 memory = ProcessMemoryBytes();
+
+    char text[TEXT_RUN_MAX];
+    const RenderCounts *calls = &last->render[STAGE_COUNT];
+    int len = snprintf(text, sizeof(text), "FPS %.1f\nFRAME P50 %.2f MS\nFRAME P99 %.2f MS\n"
+                                           "SIMULATED %u\nDRAWN %u\nDRAW CALLS %u\nPRIMITIVES %u\n"
+                                           "STATE CHANGES %u\n",
+                       fps, frame.p50, frame.p99, last->bodiesSimulated, last->bodiesDrawn,
+                       calls->drawCalls, calls->primitives, calls->stateChanges);
+    if (memory > 0)
+        snprintf(text + len, sizeof(text) - len, "MEMORY %.1f MB", memory / (1024.0 * 1024.0));
+    else
+        snprintf(text + len, sizeof(text) - len, "MEMORY -");
+    if (!TextRunSet(&hud->summary, text, HUD_SCALE))
+        return false;
+
+    len = 0;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        StageStats st = ProfileStageStats(hud->records, n, s);
+        len += snprintf(text + len, sizeof(text) - len, "%s%-9s %5.2f %6u", s > 0 ? "\n" : "",
+                        profileStageNames[s], st.mean, last->render[s].drawCalls);
+        float w = (float)(st.mean / HUD_BUDGET_MS) * HUD_BAR_W;
+        hud->stageBars[s].w = SDL_clamp(w, 1.0f, HUD_BAR_W);
+    }
+    return TextRunSet(&hud->stages, text, HUD_SCALE);
+}
+
+// drawn in the top right corner of the window
+static void DrawPerfHud(SDL_Renderer *renderer, PerfHud *hud, int winW)
+{
+    int n = ProfileCollect(hud->records, HUD_HISTORY);
+    if (n <= 0)
+        return;
+    Uint32 head = SDL_GetAtomicU32(&profiler.head);
+    bool textOk = hud->summary.rects && hud->stages.rects;
+    if (!textOk || head - hud->textFrame >= HUD_TEXT_FRAMES)
+    {
+        textOk = PerfHudUpdateText(hud, n);
+        hud->textFrame = head;
+    }
+
+    float lineH = 10.0f * HUD_SCALE;
+    float stagesW = hud->stages.width + 10.0f + HUD_BAR_W;
+    float w = SDL_max(SDL_max((float)HUD_HISTORY, hud->summary.width), stagesW) + 20.0f;
+    float h = hud->summary.height + HUD_GRAPH_H + hud->stages.height + 50.0f;
+    SDL_FRect box = {winW - w - 10.0f, 60.0f, w, h};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 190);
+    SDL_RenderFillRect(renderer, &box);
+
+    float x = box.x + 10.0f;
+    float y = box.y + 10.0f;
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    if (textOk)
+        DrawTextRun(renderer, &hud->summary, x, y);
+    y += hud->summary.height + 15.0f;
+
+    // frame history, newest on the right; the budget sits at half height
+    float pxPerMs = HUD_GRAPH_H / (float)(2.0 * HUD_BUDGET_MS);
+    float graphY = y + HUD_GRAPH_H;
+    int fast = 0, slow = 0;
+    for (int i = 0; i < n; i++)
+    {
+        float ms = hud->records[i].ns[STAGE_COUNT] / 1e6f;
+        float bh = SDL_clamp(ms * pxPerMs, 1.0f, HUD_GRAPH_H);
+        SDL_FRect bar = {x + (HUD_HISTORY - n + i), graphY - bh, 1.0f, bh};
+        if (ms <= HUD_BUDGET_MS)
+            hud->fast[fast++] = bar;
+        else
+            hud->slow[slow++] = bar;
+    }
+    SDL_SetRenderDrawColor(renderer, 80, 200, 80, 255);
+    if (fast > 0)
+        SDL_RenderFillRects(renderer, hud->fast, fast);
+    SDL_SetRenderDrawColor(renderer, 230, 70, 60, 255);
+    if (slow > 0)
+        SDL_RenderFillRects(renderer, hud->slow, slow);
+    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+    SDL_RenderLine(renderer, x, graphY - HUD_GRAPH_H * 0.5f, x + HUD_HISTORY, graphY - HUD_GRAPH_H * 0.5f);
+    y = graphY + 15.0f;
+
+    // mean per stage, a full bar is the whole frame budget
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    if (textOk)
+        DrawTextRun(renderer, &hud->stages, x, y);
+    float barX = x + hud->stages.width + 10.0f;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        hud->stageBars[s].x = barX;
+        hud->stageBars[s].y = y + s * lineH;
+        hud->stageBars[s].h = 7.0f * HUD_SCALE;
+    }
+    SDL_SetRenderDrawColor(renderer, 90, 140, 230, 255);
+    SDL_RenderFillRects(renderer, hud->stageBars, STAGE_COUNT);
+}
+
+static void PerfHudFree(PerfHud *hud)
+{
+    TextRunFree(&hud->summary);
+    TextRunFree(&hud->stages);
+}
+
+#define PROFILE_FRAME_BEGIN() ProfileFrameBegin()
+#define PROFILE_FRAME_END() ProfileFrameEnd()
+#define PROFILE_BEGIN(stage) ProfileBegin(stage)
+#define PROFILE_END(stage) ProfileEnd(stage)
+#define PROFILE_REPORT() ProfileReport()
+#define PROFILE_COUNT(counter, n) (profiler.current.counter += (n))
+#define TRACE_THREAD(name) TraceThreadName(name)
+#define TRACE_BEGIN(var) Uint64 var = SDL_GetTicksNS()
+#define TRACE_END(var, name) TraceEnd(name, var)
+#define TRACE_STOP() TraceStop()
+#else
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_BEGIN(stage) ((void)0)
+#define PROFILE_END(stage) ((void)0)
+#define PROFILE_REPORT() ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_BEGIN(var) ((void)0)
+#define TRACE_END(var, name) ((void)0)
+#define TRACE_STOP() ((void)0)
+#endif
+
+// catalog file operations timed for the hitch watchdog and the metrics
+typedef enum
+{
+    IO_LOAD_TEXT = 0,
+    IO_CATALOG_ADD,
+    IO_CATALOG_REMOVE,
+    IO_OP_COUNT
+} IoOp;
+
+static const char *const ioOpNames[IO_OP_COUNT] = {"load text catalog", "catalog add", "catalog remove"};
+static const char *const ioOpLabels[IO_OP_COUNT] = {"load_text", "add", "remove"};
+
+// Frame hitch watchdog, enabled with --hitch-ms <budget>. A frame over the
+// budget is logged to stderr with the events and the main-thread file I/O it
+// handled, plus the stage times in profiling builds. At most one report per
+// HITCH_REPORT_INTERVAL_MS; the hitches in between are counted in the next.
+#define HITCH_EVENT_KINDS 8
+#define HITCH_IO_MAX 8
+#define HITCH_REPORT_INTERVAL_MS 5000
+
+typedef struct
+{
+    IoOp op;
+    const char *path;
+    Uint64 ns;
+} HitchIo;
+
+typedef struct
+{
+    Uint64 budgetNs; // 0 when the watchdog is off
+    SDL_ThreadID mainThread;
+    Uint64 frame;
+    Uint64 frameStart;
+    Uint32 eventType[HITCH_EVENT_KINDS];
+    int eventCount[HITCH_EVENT_KINDS];
+    int eventKinds;
+    int events;
+    HitchIo io[HITCH_IO_MAX];
+    int ioCount; // may exceed HITCH_IO_MAX; only the first ones are kept
+    Uint64 lastReport;
+    int suppressed;
+    Uint64 worstSuppressedNs;
+} HitchWatch;
+
+static HitchWatch hitch;
+
+static void HitchStart(float budgetMs)
+{
+    hitch.budgetNs = (Uint64)(budgetMs * 1e6f);
+    hitch.mainThread = SDL_GetCurrentThreadID();
+}
+
+static void HitchFrameBegin(void)
+{
+    if (hitch.budgetNs == 0)
+        return;
+    hitch.frameStart = SDL_GetTicksNS();
+    hitch.eventKinds = 0;
+    hitch.events = 0;
+    hitch.ioCount = 0;
+}
+
+static void HitchNoteEvent(Uint32 type)
+{
+    if (hitch.budgetNs == 0)
+        return;
+    hitch.events++;
+    for (int i = 0; i < hitch.eventKinds; i++)
+    {
+        if (hitch.eventType[i] == type)
+        {
+            hitch.eventCount[i]++;
+            return;
+        }
+    }
+    if (hitch.eventKinds < HITCH_EVENT_KINDS)
+    {
+        hitch.eventType[hitch.eventKinds] = type;
+        hitch.eventCount[hitch.eventKinds++] = 1;
+    }
+}
+
+// main thread only, whose I/O is what stalls a frame; path must outlive the frame
+static void HitchNoteIo(IoOp op, const char *path, Uint64 ns)
+{
+    if (hitch.budgetNs == 0)
+        return;
+    if (hitch.ioCount < HITCH_IO_MAX)
+    {
+        HitchIo *io = &hitch.io[hitch.ioCount];
+        io->op = op;
+        io->path = path;
+        io->ns = ns;
+    }
+    hitch.ioCount++;
+}
+
+static const char *HitchEventName(Uint32 type)
+{
+    switch (type)
+    {
+    case SDL_EVENT_QUIT:
+        return "quit";
+    case SDL_EVENT_KEY_DOWN:
+        return "key down";
+    case SDL_EVENT_KEY_UP:
+        return "key up";
+    case SDL_EVENT_TEXT_INPUT:
+        return "text input";
+    case SDL_EVENT_MOUSE_MOTION:
+        return "mouse motion";
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        return "mouse down";
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+        return "mouse up";
+    case SDL_EVENT_MOUSE_WHEEL:
+        return "mouse wheel";
+    case SDL_EVENT_WINDOW_RESIZED:
+        return "window resized";
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        return "pixel size changed";
+    case SDL_EVENT_RENDER_DEVICE_RESET:
+        return "render device reset";
+    case SDL_EVENT_RENDER_TARGETS_RESET:
+        return "render targets reset";
+    default:
+        return NULL;
+    }
+}
+
+static void HitchFrameEnd(void)
+{
+    if (hitch.budgetNs == 0)
+        return;
+    Uint64 now = SDL_GetTicksNS();
+    Uint64 ns = now - hitch.frameStart;
+    Uint64 frame = hitch.frame++;
+    if (ns <= hitch.budgetNs)
+        return;
+    if (hitch.lastReport != 0 && now - hitch.lastReport < (Uint64)HITCH_REPORT_INTERVAL_MS * 1000000)
+    {
+        hitch.suppressed++;
+        if (ns > hitch.worstSuppressedNs)
+            hitch.worstSuppressedNs = ns;
+        return;
+    }
+    hitch.lastReport = now;
+
+    fprintf(stderr, "Hitch: frame %llu took %.1f ms (budget %.1f ms)\n", (unsigned long long)frame,
+            ns / 1e6, hitch.budgetNs / 1e6);
+#ifdef SOLAR_PROFILE
+    // the profiler published this frame's record just before
+    Uint32 head = SDL_GetAtomicU32(&profiler.head);
+    if (head > 0)
+    {
+        const FrameRecord *r = &profiler.ring[(head - 1) & (PROFILE_RING - 1)];
+        Uint64 staged = 0;
+        fprintf(stderr, "  stages:");
+        for (int s = 0; s < STAGE_COUNT; s++)
+        {
+            fprintf(stderr, " %s %.1f", profileStageNames[s], r->ns[s] / 1e6);
+            staged += r->ns[s];
+        }
+        fprintf(stderr, ", outside stages %.1f ms\n",
+                r->ns[STAGE_COUNT] > staged ? (r->ns[STAGE_COUNT] - staged) / 1e6 : 0.0);
+    }
+#endif
+    fprintf(stderr, "  events: %d", hitch.events);
+    for (int i = 0; i < hitch.eventKinds; i++)
+    {
+        const char *name = HitchEventName(hitch.eventType[i]);
+        fprintf(stderr, "%s", i == 0 ? " (" : ", ");
+        if (name)
+            fprintf(stderr, "%s", name);
+        else
+            fprintf(stderr, "event 0x%x", (unsigned int)hitch.eventType[i]);
+        fprintf(stderr, " x%d%s", hitch.eventCount[i], i == hitch.eventKinds - 1 ? ")" : "");
+    }
+    fprintf(stderr, "\n");
+    if (hitch.ioCount == 0)
+        fprintf(stderr, "  file I/O: none\n");
+    for (int i = 0; i < hitch.ioCount && i < HITCH_IO_MAX; i++)
+        fprintf(stderr, "  file I/O: %s '%s' %.1f ms\n", ioOpNames[hitch.io[i].op], hitch.io[i].path,
+                hitch.io[i].ns / 1e6);
+    if (hitch.ioCount > HITCH_IO_MAX)
+        fprintf(stderr, "  file I/O: %d more not shown\n", hitch.ioCount - HITCH_IO_MAX);
+    if (hitch.suppressed > 0)
+        fprintf(stderr, "  hitches since the last report: %d, the worst %.1f ms\n", hitch.suppressed,
+                hitch.worstSuppressedNs / 1e6);
+    hitch.suppressed = 0;
+    hitch.worstSuppressedNs = 0;
+}
+
+// Prometheus metrics, served with --metrics <port> on 127.0.0.1 or with
+// --metrics unix:<path> on a Unix domain socket. A side thread answers the
+// scrapes. The main thread counts into its own copy of the values and hands
+// it over with a try-lock once a frame, skipping the frame if a scrape holds
+// the lock, so the render loop never waits. Other threads count under the
+// lock into a second copy.
+#define METRICS_FRAME_BUCKETS 8
+#define METRICS_IO_BUCKETS 6
+#define METRICS_BODY_MAX 8192
+
+static const double metricsFrameBounds[METRICS_FRAME_BUCKETS] = {
+    0.004, 0.008, 0.016, 0.033, 0.05, 0.1, 0.25, 1.0}; // seconds
+static const double metricsIoBounds[METRICS_IO_BUCKETS] = {0.001, 0.005, 0.025, 0.1, 0.5, 2.5};
+
+typedef struct
+{
+    Uint64 frames;
+    Uint64 frameBuckets[METRICS_FRAME_BUCKETS + 1]; // per bucket, the last one above every bound
+    Uint64 frameNs;
+    Uint64 io[IO_OP_COUNT];
+    Uint64 ioBuckets[IO_OP_COUNT][METRICS_IO_BUCKETS + 1];
+    Uint64 ioNs[IO_OP_COUNT];
+    Uint64 ioErrors[IO_OP_COUNT];
+    Uint64 malformedLines;
+    int planets; // gauges, as of the last frame
+    int moons;
+    int asteroids;
+    int catalogBodies;
+} MetricsValues;
+
+typedef struct
+{
+    bool running;
+    SDL_ThreadID mainThread;
+    MetricsValues local; // main thread only
+    SDL_Mutex *lock;
+    MetricsValues published; // the main thread's values as of its last hand-over
+    MetricsValues offThread;
+    Uint64 frameStart;
+    SDL_Thread *thread;
+    SDL_AtomicInt quit;
+    int listenFd;
+    char unixPath[108];
+} MetricsServer;
+
+static MetricsServer metrics;
+
+static int MetricsBucket(const double *bounds, int count, double seconds)
+{
+    int b = 0;
+    while (b < count && seconds > bounds[b])
+        b++;
+    return b;
+}
+
+// returns the values this thread counts into, locked unless they are the main thread's
+static MetricsValues *MetricsAcquire(void)
+{
+    if (SDL_GetCurrentThreadID() == metrics.mainThread)
+        return &metrics.local;
+    SDL_LockMutex(metrics.lock);
+    return &metrics.offThread;
+}
+
+static void MetricsRelease(MetricsValues *values)
+{
+    if (values != &metrics.local)
+        SDL_UnlockMutex(metrics.lock);
+}
+
+static void MetricsNoteIo(IoOp op, Uint64 ns, bool ok)
+{
+    if (!metrics.running)
+        return;
+    MetricsValues *v = MetricsAcquire();
+    v->io[op]++;
+    v->ioBuckets[op][MetricsBucket(metricsIoBounds, METRICS_IO_BUCKETS, ns / 1e9)]++;
+    v->ioNs[op] += ns;
+    if (!ok)
+        v->ioErrors[op]++;
+    MetricsRelease(v);
+}
+
+static void MetricsNoteMalformed(int lines)
+{
+    if (!metrics.running || lines == 0)
+        return;
+    MetricsValues *v = MetricsAcquire();
+    v->malformedLines += (Uint64)lines;
+    MetricsRelease(v);
+}
+
+static void MetricsFrameBegin(void)
+{
+    if (!metrics.running)
+        return;
+    metrics.frameStart = SDL_GetTicksNS();
+    metrics.local.planets = 0;
+    metrics.local.moons = 0;
+    metrics.local.asteroids = 0;
+}
+
+static void MetricsSimulated(int planets, int moons, int asteroids)
+{
+    metrics.local.planets = planets;
+    metrics.local.moons = moons;
+    metrics.local.asteroids = asteroids;
+}
+
+static void MetricsFrameEnd(int catalogBodies)
+{
+    if (!metrics.running)
+        return;
+    Uint64 ns = SDL_GetTicksNS() - metrics.frameStart;
+    MetricsValues *v = &metrics.local;
+    v->frames++;
+    v->frameBuckets[MetricsBucket(metricsFrameBounds, METRICS_FRAME_BUCKETS, ns / 1e9)]++;
+    v->frameNs += ns;
+    v->catalogBodies = catalogBodies;
+    if (SDL_TryLockMutex(metrics.lock))
+    {
+        metrics.published = *v;
+        SDL_UnlockMutex(metrics.lock);
+    }
+}
+
+#ifndef _WIN32
+static void MetricsAppend(char *buf, int *len, const char *fmt, ...)
+{
+    if (*len >= METRICS_BODY_MAX)
+        return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *len, (size_t)(METRICS_BODY_MAX - *len), fmt, args);
+    va_end(args);
+    if (n > 0)
+        *len = SDL_min(*len + n, METRICS_BODY_MAX);
+}
+
+// label is empty or one name="value" pair
+static void MetricsHistogram(char *buf, int *len, const char *name, const char *label, const double *bounds,
+                             int count, const Uint64 *buckets, Uint64 total, Uint64 ns)
+{
+    const char *sep = label[0] ? "," : "";
+    char braced[64];
+    snprintf(braced, sizeof(braced), label[0] ? "{%s}" : "%s", label);
+    Uint64 cumulative = 0;
+    for (int b = 0; b < count; b++)
+    {
+        cumulative += buckets[b];
+        MetricsAppend(buf, len, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, label, sep, bounds[b],
+                      (unsigned long long)cumulative);
+    }
+    MetricsAppend(buf, len, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, label, sep, (unsigned long long)total);
+    MetricsAppend(buf, len, "%s_sum%s %.6f\n", name, braced, ns / 1e9);
+    MetricsAppend(buf, len, "%s_count%s %llu\n", name, braced, (unsigned long long)total);
+}
+
+static int MetricsFormat(char *buf)
+{
+    SDL_LockMutex(metrics.lock);
+    MetricsValues v = metrics.published;
+    MetricsValues other = metrics.offThread;
+    SDL_UnlockMutex(metrics.lock);
+    for (int op = 0; op < IO_OP_COUNT; op++)
+    {
+        v.io[op] += other.io[op];
+        v.ioNs[op] += other.ioNs[op];
+        v.ioErrors[op] += other.ioErrors[op];
+        for (int b = 0; b <= METRICS_IO_BUCKETS; b++)
+            v.ioBuckets[op][b] += other.ioBuckets[op][b];
+    }
+    v.malformedLines += other.malformedLines;
+
+    int len = 0;
+    MetricsAppend(buf, &len, "# HELP solar_frame_seconds Time from the start of a frame to its present.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_frame_seconds histogram\n");
+    MetricsHistogram(buf, &len, "solar_frame_seconds", "", metricsFrameBounds, METRICS_FRAME_BUCKETS,
+                     v.frameBuckets, v.frames, v.frameNs);
+    MetricsAppend(buf, &len, "# HELP solar_bodies_simulated Bodies advanced in the last frame.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_bodies_simulated gauge\n");
+    MetricsAppend(buf, &len, "solar_bodies_simulated{kind=\"planet\"} %d\n", v.planets);
+    MetricsAppend(buf, &len, "solar_bodies_simulated{kind=\"moon\"} %d\n", v.moons);
+    MetricsAppend(buf, &len, "solar_bodies_simulated{kind=\"asteroid\"} %d\n", v.asteroids);
+    MetricsAppend(buf, &len, "# HELP solar_catalog_bodies Catalog bodies held in memory.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_catalog_bodies gauge\n");
+    MetricsAppend(buf, &len, "solar_catalog_bodies %d\n", v.catalogBodies);
+    MetricsAppend(buf, &len, "# HELP solar_io_seconds Catalog file operations by kind, on any thread.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_io_seconds histogram\n");
+    for (int op = 0; op < IO_OP_COUNT; op++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "op=\"%s\"", ioOpLabels[op]);
+        MetricsHistogram(buf, &len, "solar_io_seconds", label, metricsIoBounds, METRICS_IO_BUCKETS,
+                         v.ioBuckets[op], v.io[op], v.ioNs[op]);
+    }
+    MetricsAppend(buf, &len, "# HELP solar_io_errors_total Catalog file operations that failed.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_io_errors_total counter\n");
+    for (int op = 0; op < IO_OP_COUNT; op++)
+        MetricsAppend(buf, &len, "solar_io_errors_total{op=\"%s\"} %llu\n", ioOpLabels[op],
+                      (unsigned long long)v.ioErrors[op]);
+    MetricsAppend(buf, &len, "# HELP solar_catalog_malformed_lines_total Text catalog lines that failed to parse.\n");
+    MetricsAppend(buf, &len, "# TYPE solar_catalog_malformed_lines_total counter\n");
+    MetricsAppend(buf, &len, "solar_catalog_malformed_lines_total %llu\n", (unsigned long long)v.malformedLines);
+    return len;
+}
+
+static void MetricsSend(int fd, const char *data, size_t size)
+{
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+    while (size > 0)
+    {
+        ssize_t n = send(fd, data, size, flags);
+        if (n <= 0)
+            return;
+        data += n;
+        size -= (size_t)n;
+    }
+}
+
+// one request per connection; anything but GET /metrics or GET / is a 404
+static void MetricsServe(int fd, char *body)
+{
+    char request[1024];
+    size_t got = 0;
+    while (got < sizeof(request) - 1)
+    {
+        ssize_t n = recv(fd, request + got, sizeof(request) - 1 - got, 0);
+        if (n <= 0)
+            break;
+        got += (size_t)n;
+        request[got] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+            break;
+    }
+    request[got] = '\0';
+    char header[256];
+    if (strncmp(request, "GET /metrics ", 13) != 0 && strncmp(request, "GET / ", 6) != 0)
+    {
+        static const char notFound[] = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        MetricsSend(fd, notFound, sizeof(notFound) - 1);
+        return;
+    }
+    int len = MetricsFormat(body);
+    int headerLen = snprintf(header, sizeof(header),
+                             "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                             "Content-Length: %d\r\nConnection: close\r\n\r\n",
+                             len);
+    MetricsSend(fd, header, (size_t)headerLen);
+    MetricsSend(fd, body, (size_t)len);
+}
+
+static int MetricsThread(void *data)
+{
+    (void)data;
+    TRACE_THREAD("metrics");
+    char *body = (char *)malloc(METRICS_BODY_MAX);
+    if (!body)
+    {
+        fprintf(stderr, "Out of memory starting the metrics server\n");
+        return 0;
+    }
+    struct pollfd pfd = {metrics.listenFd, POLLIN, 0};
+    while (!SDL_GetAtomicInt(&metrics.quit))
+    {
+        if (poll(&pfd, 1, 200) <= 0)
+            continue;
+        int fd = accept(metrics.listenFd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        // a stalled client holds up only this thread, and not for long
+        struct timeval timeout = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        MetricsServe(fd, body);
+        close(fd);
+    }
+    free(body);
+    return 0;
+}
+#endif
+
+// address is a TCP port on 127.0.0.1 or unix:<path>
+static bool MetricsStart(const char *address)
+{
+#ifdef _WIN32
+    fprintf(stderr, "The metrics server is not available on Windows.\n");
+    (void)address;
+    return false;
+#else
+    bool isUnix = strncmp(address, "unix:", 5) == 0;
+    int fd = socket(isUnix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to create the metrics socket: %s\n", strerror(errno));
+        return false;
+    }
+    bool bound;
+    if (isUnix)
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path) || address[5] == '\0')
+        {
+            fprintf(stderr, "Bad metrics socket path '%s'\n", address + 5);
+            close(fd);
+            return false;
+        }
+        SDL_strlcpy(addr.sun_path, address + 5, sizeof(addr.sun_path));
+        // only a socket left over from an earlier run is replaced
+        struct stat st;
+        if (lstat(addr.sun_path, &st) == 0)
+        {
+            if (!S_ISSOCK(st.st_mode))
+            {
+                fprintf(stderr, "Metrics socket '%s': path exists and is not a socket\n", addr.sun_path);
+                close(fd);
+                return false;
+            }
+            unlink(addr.sun_path);
+        }
+        bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        if (bound)
+            SDL_strlcpy(metrics.unixPath, addr.sun_path, sizeof(metrics.unixPath));
+    }
+    else
+    {
+        char *end;
+        long port = strtol(address, &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535)
+        {
+            fprintf(stderr, "Bad metrics port '%s'; give a port or unix:<path>\n", address);
+            close(fd);
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    }
+    if (!bound || listen(fd, 8) != 0)
+    {
+        fprintf(stderr, "Failed to listen for metrics on '%s': %s\n", address, strerror(errno));
+        close(fd);
+        return false;
+    }
+    metrics.lock = SDL_CreateMutex();
+    metrics.listenFd = fd;
+    metrics.mainThread = SDL_GetCurrentThreadID();
+    SDL_SetAtomicInt(&metrics.quit, 0);
+    metrics.thread = metrics.lock ? SDL_CreateThread(MetricsThread, "metrics", NULL) : NULL;
+    if (!metrics.thread)
+    {
+        fprintf(stderr, "Failed to start the metrics server: %s\n", SDL_GetError());
+        SDL_DestroyMutex(metrics.lock);
+        close(fd);
+        if (metrics.unixPath[0])
+            unlink(metrics.unixPath);
+        memset(&metrics, 0, sizeof(metrics));
+        return false;
+    }
+    metrics.running = true;
+    return true;
+#endif
+}
+
+// after every thread that counts I/O has stopped
+static void MetricsStop(void)
+{
+#ifndef _WIN32
+    if (!metrics.running)
+        return;
+    SDL_SetAtomicInt(&metrics.quit, 1);
+    SDL_WaitThread(metrics.thread, NULL);
+    close(metrics.listenFd);
+    if (metrics.unixPath[0])
+        unlink(metrics.unixPath);
+    SDL_DestroyMutex(metrics.lock);
+    memset(&metrics, 0, sizeof(metrics));
+#endif
+}
+
+// 0 when neither the watchdog nor the metrics want the time
+static Uint64 IoBegin(void)
+{
+    if (hitch.budgetNs == 0 && !metrics.running)
+        return 0;
+    return SDL_GetTicksNS();
+}
+
+static void IoEnd(IoOp op, const char *path, Uint64 start, bool ok)
+{
+    if (start == 0)
+        return;
+    Uint64 ns = SDL_GetTicksNS() - start;
+    if (SDL_GetCurrentThreadID() == hitch.mainThread)
+        HitchNoteIo(op, path, ns);
+    MetricsNoteIo(op, ns, ok);
+}
+
+static void ProjectXZ3D(
+    float worldX, float worldZ,
+    float cosYaw, float sinYaw,
+    float cosPitch, float sinPitch,
+    float camDist, float fov,
+    float cx, float cy,
+    float panX, float panY,
+    float *outX, float *outY, float *outDepth)
+{
+    float x1 = worldX * cosYaw + worldZ * sinYaw;
+    float z1 = -worldX * sinYaw + worldZ * cosYaw;
+    float y1 = 0.0f;
+    float y2 = y1 * cosPitch - z1 * sinPitch;
+    float z2 = y1 * sinPitch + z1 * cosPitch;
+    float x2 = x1;
+    float cz = z2 + camDist;
+    if (cz < 1.0f)
+        cz = 1.0f;
+    float inv = fov / cz;
+    *outX = cx + panX + x2 * inv;
+    *outY = cy + panY + y2 * inv;
+    if (outDepth)
+        *outDepth = cz;
+}
+
+// ProjectXZ3D over n points, with the constant camera terms hoisted out of the
+// loop. Strides are in bytes so the points can sit inside structs.
+static void ProjectXZ3DBatch(
+    int n,
+    const float *worldX, const float *worldZ, size_t inStride,
+    float cosYaw, float sinYaw,
+    float cosPitch, float sinPitch,
+    float camDist, float fov,
+    float cx, float cy,
+    float panX, float panY,
+    float *outX, float *outY, float *outDepth, size_t outStride)
+{
+    const char *inX = (const char *)worldX;
+    const char *inZ = (const char *)worldZ;
+    char *dstX = (char *)outX;
+    char *dstY = (char *)outY;
+    char *dstDepth = (char *)outDepth;
+    float originX = cx + panX;
+    float originY = cy + panY;
+    for (int i = 0; i < n; i++)
+    {
+        float wx = *(const float *)(inX + i * inStride);
+        float wz = *(const float *)(inZ + i * inStride);
+        float x1 = wx * cosYaw + wz * sinYaw;
+        float z1 = -wx * sinYaw + wz * cosYaw;
+        float cz = z1 * cosPitch + camDist;
+        if (cz < 1.0f)
+            cz = 1.0f;
+        float inv = fov / cz;
+        *(float *)(dstX + i * outStride) = originX + x1 * inv;
+        *(float *)(dstY + i * outStride) = originY - z1 * sinPitch * inv;
+        *(float *)(dstDepth + i * outStride) = cz;
+    }
+}
+
+static void BodyStoreInit(BodyStore *store)
+{
+    memset(store, 0, sizeof(*store));
+    store->freeHead = BODY_SLOT_NONE;
+}
+
+static void BodyStoreFree(BodyStore *store)
+{
+    free(store->bodies);
+    free(store->denseSlot);
+    free(store->slotDense);
+    free(store->slotGeneration);
+    BodyStoreInit(store);
+}
+
+static int BodyStoreReserve(BodyStore *store, int capacity)
+{
+    if (capacity <= store->capacity)
+        return 1;
+    int newCap = store->capacity > 0 ? store->capacity : 16;
+    while (newCap < capacity)
+        newCap *= 2;
+
+    Planet *bodies = (Planet *)realloc(store->bodies, sizeof(Planet) * newCap);
+    if (!bodies)
+        return 0;
+    store->bodies = bodies;
+    Uint32 *denseSlot = (Uint32 *)realloc(store->denseSlot, sizeof(Uint32) * newCap);
+    if (!denseSlot)
+        return 0;
+    store->denseSlot = denseSlot;
+    Uint32 *slotDense = (Uint32 *)realloc(store->slotDense, sizeof(Uint32) * newCap);
+    if (!slotDense)
+        return 0;
+    store->slotDense = slotDense;
+    Uint32 *slotGeneration = (Uint32 *)realloc(store->slotGeneration, sizeof(Uint32) * newCap);
+    if (!slotGeneration)
+        return 0;
+    store->slotGeneration = slotGeneration;
+    store->capacity = newCap;
+    return 1;
+}
+
+static BodyHandle BodyStoreHandleAt(const BodyStore *store, int denseIndex)
+{
+    BodyHandle h = {0, 0};
+    if (denseIndex < 0 || denseIndex >= store->count)
+        return h;
+    h.slot = store->denseSlot[denseIndex];
+    h.generation = store->slotGeneration[h.slot];
+    return h;
+}
+
+static bool BodyHandleEquals(BodyHandle a, BodyHandle b)
+{
+    return a.slot == b.slot && a.generation == b.generation;
+}
+
+// returns the dense index of a live handle, or -1 if it is stale
+static int BodyStoreIndexOf(const BodyStore *store, BodyHandle h)
+{
+    if (h.generation == 0 || h.slot >= store->slotCount)
+        return -1;
+    if (store->slotGeneration[h.slot] != h.generation)
+        return -1;
+    return (int)store->slotDense[h.slot];
+}
+
+static Planet *BodyStoreGet(BodyStore *store, BodyHandle h)
+{
+    int idx = BodyStoreIndexOf(store, h);
+    return idx >= 0 ? &store->bodies[idx] : NULL;
+}
+
+static BodyHandle BodyStoreAdd(BodyStore *store, const Planet *body)
+{
+    BodyHandle h = {0, 0};
+    if (!BodyStoreReserve(store, store->count + 1))
+        return h;
+
+    Uint32 slot;
+    if (store->freeHead != BODY_SLOT_NONE)
+    {
+        slot = store->freeHead;
+        store->freeHead = store->slotDense[slot];
+    }
+    else
+    {
+        slot = store->slotCount++;
+        store->slotGeneration[slot] = 1;
+    }
+
+    int idx = store->count++;
+    store->bodies[idx] = *body;
+    store->denseSlot[idx] = slot;
+    store->slotDense[slot] = (Uint32)idx;
+    h.slot = slot;
+    h.generation = store->slotGeneration[slot];
+    return h;
+}
+
+// bulk append for loaders; returns false if the store could not grow
+static bool BodyStoreAddMany(BodyStore *store, const Planet *bodies, int n)
+{
+    if (n <= 0)
+        return true;
+    if (!BodyStoreReserve(store, store->count + n))
+        return false;
+    memcpy(&store->bodies[store->count], bodies, sizeof(Planet) * n);
+    for (int i = 0; i < n; i++)
+    {
+        Uint32 slot;
+        if (store->freeHead != BODY_SLOT_NONE)
+        {
+            slot = store->freeHead;
+            store->freeHead = store->slotDense[slot];
+        }
+        else
+        {
+            slot = store->slotCount++;
+            store->slotGeneration[slot] = 1;
+        }
+        int idx = store->count++;
+        store->denseSlot[idx] = slot;
+        store->slotDense[slot] = (Uint32)idx;
+    }
+    return true;
+}
+
+static void BodyStoreReleaseSlot(BodyStore *store, Uint32 slot)
+{
+    if (++store->slotGeneration[slot] == 0)
+        store->slotGeneration[slot] = 1;
+    store->slotDense[slot] = store->freeHead;
+    store->freeHead = slot;
+}
+
+// swap-remove: the last body moves into the hole, its handle stays valid
+static bool BodyStoreRemove(BodyStore *store, BodyHandle h)
+{
+    int idx = BodyStoreIndexOf(store, h);
+    if (idx < 0)
+        return false;
+
+    int last = store->count - 1;
+    if (idx != last)
+    {
+        Uint32 movedSlot = store->denseSlot[last];
+        store->bodies[idx] = store->bodies[last];
+        store->denseSlot[idx] = movedSlot;
+        store->slotDense[movedSlot] = (Uint32)idx;
+    }
+    store->count--;
+    BodyStoreReleaseSlot(store, h.slot);
+    return true;
+}
+
+// invalidates every outstanding handle but keeps the allocations
+static void BodyStoreClear(BodyStore *store)
+{
+    for (int i = 0; i < store->count; i++)
+        BodyStoreReleaseSlot(store, store->denseSlot[i]);
+    store->count = 0;
+}
+
+// Bodies sorted by name, case-insensitively, for prefix search. Each entry
+// carries the first eight folded characters as a big-endian integer, so most
+// comparisons never touch the names. Edits are queued and merged in by
+// NameIndexSync; removed bodies are noticed there without being reported.
+typedef struct
+{
+    Uint64 key;
+    BodyHandle handle; // zeroed once the entry is superseded by a rename
+} NameIndexEntry;
+
+typedef struct
+{
+    NameIndexEntry *entries;
+    int count;
+    int capacity;
+    BodyHandle *pending; // added bodies not merged yet
+    int numPending;
+    int capPending;
+    int tombstones;
+    bool dirty; // rebuild from scratch on the next sync
+} NameIndex;
+
+static char NameFold(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+// stale entries read as "" until the next sync drops them
+static const char *NameIndexEntryName(const BodyStore *store, const NameIndexEntry *e)
+{
+    int idx = BodyStoreIndexOf(store, e->handle);
+    return idx >= 0 ? store->bodies[idx].name : "";
+}
+
+static Uint64 NameKey(const char *s)
+{
+    Uint64 k = 0;
+    int i = 0;
+    for (; i < 8 && s[i]; i++)
+        k = (k << 8) | (Uint8)NameFold(s[i]);
+    return i == 0 ? 0 : k << (8 * (8 - i));
+}
+
+// folded comparison of at most n characters
+static int NameCompareN(const char *a, const char *b, size_t n)
+{
+    for (; n > 0; n--, a++, b++)
+    {
+        Uint8 ca = (Uint8)NameFold(*a);
+        Uint8 cb = (Uint8)NameFold(*b);
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+        if (!ca)
+            break;
+    }
+    return 0;
+}
+
+static int NameIndexOrder(Uint64 keyA, const char *nameA, Uint64 keyB, const char *nameB)
+{
+    if (keyA != keyB)
+        return keyA < keyB ? -1 : 1;
+    if (strlen(nameA) < 8)
+        return 0; // the key held the whole name
+    return NameCompareN(nameA + 8, nameB + 8, (size_t)-1);
+}
+
+// sorting also keys the next eight characters, which keeps catalogs of
+// "Minor Body 123"-style names off the string comparison
+typedef struct
+{
+    Uint64 key;
+    Uint64 key2;
+    const char *name;
+    BodyHandle handle;
+} NameSortItem;
+
+static int CompareNameSortItems(const void *a, const void *b)
+{
+    const NameSortItem *x = (const NameSortItem *)a;
+    const NameSortItem *y = (const NameSortItem *)b;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    if (x->key2 != y->key2)
+        return x->key2 < y->key2 ? -1 : 1;
+    if (strlen(x->name) < 16)
+        return 0;
+    return NameCompareN(x->name + 16, y->name + 16, (size_t)-1);
+}
+
+static bool NameIndexReserve(NameIndex *ix, int n)
+{
+    if (n <= ix->capacity)
+        return true;
+    int newCap = ix->capacity > 0 ? ix->capacity : 64;
+    while (newCap < n)
+        newCap *= 2;
+    NameIndexEntry *tmp = (NameIndexEntry *)realloc(ix->entries, sizeof(NameIndexEntry) * newCap);
+    if (!tmp)
+        return false;
+    ix->entries = tmp;
+    ix->capacity = newCap;
+    return true;
+}
+
+// sorts handles[0..n) by name through a scratch array that carries the names
+static bool SortHandlesByName(const BodyStore *store, const BodyHandle *handles, int n,
+                              NameIndexEntry *out)
+{
+    NameSortItem *items = (NameSortItem *)malloc(sizeof(NameSortItem) * (n > 0 ? n : 1));
+    if (!items)
+        return false;
+    for (int i = 0; i < n; i++)
+    {
+        const char *name = store->bodies[store->slotDense[handles[i].slot]].name;
+        items[i].key = NameKey(name);
+        items[i].key2 = (items[i].key & 0xFF) ? NameKey(name + 8) : 0;
+        items[i].name = name;
+        items[i].handle = handles[i];
+    }
+    qsort(items, (size_t)n, sizeof(NameSortItem), CompareNameSortItems);
+    for (int i = 0; i < n; i++)
+    {
+        out[i].key = items[i].key;
+        out[i].handle = items[i].handle;
+    }
+    free(items);
+    return true;
+}
+
+static bool NameIndexBuild(NameIndex *ix, const BodyStore *store)
+{
+    ix->count = 0;
+    ix->numPending = 0;
+    ix->tombstones = 0;
+    ix->dirty = true;
+    BodyHandle *handles = (BodyHandle *)malloc(sizeof(BodyHandle) * (store->count + 1));
+    if (!handles || !NameIndexReserve(ix, store->count))
+    {
+        free(handles);
+        return false;
+    }
+    for (int i = 0; i < store->count; i++)
+        handles[i] = BodyStoreHandleAt(store, i);
+    bool ok = SortHandlesByName(store, handles, store->count, ix->entries);
+    free(handles);
+    if (!ok)
+        return false;
+    ix->count = store->count;
+    ix->dirty = false;
+    return true;
+}
+
+static void NameIndexFree(NameIndex *ix)
+{
+    free(ix->entries);
+    free(ix->pending);
+    memset(ix, 0, sizeof(*ix));
+}
+
+static void NameIndexAdd(NameIndex *ix, BodyHandle h)
+{
+    if (h.generation == 0 || ix->dirty)
+        return;
+    if (ix->numPending == ix->capPending)
+    {
+        int newCap = ix->capPending > 0 ? ix->capPending * 2 : 64;
+        BodyHandle *tmp = (BodyHandle *)realloc(ix->pending, sizeof(BodyHandle) * newCap);
+        if (!tmp)
+        {
+            ix->dirty = true;
+            return;
+        }
+        ix->pending = tmp;
+        ix->capPending = newCap;
+    }
+    ix->pending[ix->numPending++] = h;
+}
+
+// for bodies that came or went without being reported one by one
+static void NameIndexInvalidate(NameIndex *ix)
+{
+    ix->dirty = true;
+}
+
+// first entry whose name is not below prefix (upper: above prefix), where a
+// name matching the whole prefix compares equal
+static int NameIndexBound(const NameIndex *ix, const BodyStore *store, const char *prefix, bool upper)
+{
+    size_t len = strlen(prefix);
+    Uint64 preKey = NameKey(prefix);
+    Uint64 mask = len >= 8 ? ~(Uint64)0 : ~(~(Uint64)0 >> (8 * len));
+    int lo = 0, hi = ix->count;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        const NameIndexEntry *e = &ix->entries[mid];
+        Uint64 k = e->key & mask;
+        int c = k == preKey ? 0 : (k < preKey ? -1 : 1);
+        if (c == 0 && len > 8)
+        {
+            const char *name = NameIndexEntryName(store, e);
+            c = strlen(name) < 8 ? -1 : NameCompareN(name + 8, prefix + 8, len - 8);
+        }
+        if (c < 0 || (upper && c == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// entries [*first, *first + count) are the bodies whose names start with
+// prefix; the index must be in sync
+static int NameIndexFindPrefix(const NameIndex *ix, const BodyStore *store, const char *prefix, int *first)
+{
+    *first = NameIndexBound(ix, store, prefix, false);
+    return NameIndexBound(ix, store, prefix, true) - *first;
+}
+
+// call before overwriting the name of a live body in place
+static void NameIndexRename(NameIndex *ix, const BodyStore *store, BodyHandle h)
+{
+    if (ix->dirty || ix->numPending > 0 || ix->tombstones > 0 || ix->count != store->count)
+    {
+        // entries may be out of order until the next sync
+        ix->dirty = true;
+        return;
+    }
+    const char *name = store->bodies[store->slotDense[h.slot]].name;
+    int first;
+    int n = NameIndexFindPrefix(ix, store, name, &first);
+    for (int i = first; i < first + n; i++)
+    {
+        if (BodyHandleEquals(ix->entries[i].handle, h))
+        {
+            ix->entries[i].handle.generation = 0;
+            ix->tombstones++;
+            NameIndexAdd(ix, h);
+            return;
+        }
+    }
+    ix->dirty = true;
+}
+
+static bool NameIndexInSync(const NameIndex *ix, const BodyStore *store)
+{
+    return !ix->dirty && ix->numPending == 0 && ix->tombstones == 0 && ix->count == store->count;
+}
+
+// drops entries of removed bodies and merges the pending adds; O(n) when
+// anything changed, O(1) otherwise
+static bool NameIndexSync(NameIndex *ix, const BodyStore *store)
+{
+    if (ix->dirty)
+        return NameIndexBuild(ix, store);
+    if (NameIndexInSync(ix, store))
+        return true;
+
+    int n = 0;
+    for (int i = 0; i < ix->count; i++)
+    {
+        if (BodyStoreIndexOf(store, ix->entries[i].handle) >= 0)
+            ix->entries[n++] = ix->entries[i];
+    }
+    int numNew = 0;
+    for (int i = 0; i < ix->numPending; i++)
+    {
+        if (BodyStoreIndexOf(store, ix->pending[i]) >= 0)
+            ix->pending[numNew++] = ix->pending[i];
+    }
+    NameIndexEntry *added = (NameIndexEntry *)malloc(sizeof(NameIndexEntry) * (numNew + 1));
+    if (!added || !NameIndexReserve(ix, n + numNew) ||
+        !SortHandlesByName(store, ix->pending, numNew, added))
+    {
+        free(added);
+        return NameIndexBuild(ix, store);
+    }
+
+    // merge from the back so nothing is overwritten before it is moved
+    int a = n - 1, b = numNew - 1;
+    for (int out = n + numNew - 1; b >= 0; out--)
+    {
+        const char *nameA = a >= 0 ? NameIndexEntryName(store, &ix->entries[a]) : NULL;
+        const char *nameB = NameIndexEntryName(store, &added[b]);
+        if (a >= 0 && NameIndexOrder(ix->entries[a].key, nameA, added[b].key, nameB) > 0)
+            ix->entries[out] = ix->entries[a--];
+        else
+            ix->entries[out] = added[b--];
+    }
+    free(added);
+    ix->count = n + numNew;
+    ix->numPending = 0;
+    ix->tombstones = 0;
+    if (ix->count != store->count)
+        return NameIndexBuild(ix, store);
+    return true;
+}
+
+static void ClampColorInt(int *v)
+{
+    if (*v < 0)
+        *v = 0;
+    if (*v > 255)
+        *v = 255;
+}
+
+static void InitPlanet(Planet *p, const char *name,
+                       float orbitRadius, float angularSpeed, float radius,
+                       int r, int g, int b)
+{
+    memset(p, 0, sizeof(*p));
+    strncpy(p->name, name, sizeof(p->name) - 1);
+    p->orbitRadius = orbitRadius;
+    p->angularSpeed = angularSpeed;
+    p->angle = 0.0f;
+    p->circle.radius = radius;
+    p->circle.r = (Uint8)r;
+    p->circle.g = (Uint8)g;
+    p->circle.b = (Uint8)b;
+    p->worldX = 0.0f;
+    p->worldZ = p->orbitRadius;
+    p->depth = 1.0f;
+    p->screenRadius = 0.0f;
+}
+
+#define CATALOG_MAX_REPORTED_ERRORS 10
+#define CATALOG_MAX_WORKERS 16
+#define CATALOG_MIN_CHUNK_BYTES (1 << 20)
+
+static bool IsCatalogSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22};
+
+// decimal float without locale or strtof; rejects anything but the whole token
+static bool ParseCatalogFloat(const char *p, const char *end, float *out)
+{
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+
+    Uint64 mant = 0;
+    int digits = 0, scale = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+    {
+        if (mant < 100000000000000000ull)
+            mant = mant * 10 + (Uint64)(*p - '0');
+        else
+            scale++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (mant < 100000000000000000ull)
+            {
+                mant = mant * 10 + (Uint64)(*p - '0');
+                scale--;
+            }
+        }
+    }
+    if (digits == 0)
+        return false;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool expNeg = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            expNeg = (*p++ == '-');
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            if (e < 10000)
+                e = e * 10 + (*p - '0');
+        scale += expNeg ? -e : e;
+    }
+    if (p != end)
+        return false;
+
+    double v = (double)mant;
+    while (scale > 22)
+    {
+        v *= 1e22;
+        scale -= 22;
+    }
+    while (scale < -22)
+    {
+        v /= 1e22;
+        scale += 22;
+    }
+    v = scale >= 0 ? v * kPow10[scale] : v / kPow10[-scale];
+    *out = (float)(neg ? -v : v);
+    return true;
+}
+
+static bool ParseCatalogInt(const char *p, const char *end, int *out)
+{
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+    if (p == end)
+        return false;
+    int v = 0;
+    for (; p < end; p++)
+    {
+        if (*p < '0' || *p > '9')
+            return false;
+        if (v < 100000)
+            v = v * 10 + (*p - '0');
+    }
+    *out = neg ? -v : v;
+    return true;
+}
+
+// "name orbit speed radius r g b"; the name is everything before the last six
+// fields, so it may contain spaces. Returns 0 to skip, 1 on a body, -1 on error.
+static int ParseCatalogLine(const char *line, const char *end, Planet *out, const char **err)
+{
+    while (line < end && IsCatalogSpace(*line))
+        line++;
+    while (end > line && IsCatalogSpace(end[-1]))
+        end--;
+    if (line == end || *line == '#')
+        return 0;
+
+    const char *tokBegin[6];
+    const char *tokEnd[6];
+    const char *p = end;
+    for (int t = 5; t >= 0; t--)
+    {
+        tokEnd[t] = p;
+        while (p > line && !IsCatalogSpace(p[-1]))
+            p--;
+        tokBegin[t] = p;
+        while (p > line && IsCatalogSpace(p[-1]))
+            p--;
+        if (p == line)
+        {
+            *err = "expected: name orbit speed radius r g b";
+            return -1;
+        }
+    }
+
+    float orbitRadius, angularSpeed, radius;
+    int rgb[3];
+    if (!ParseCatalogFloat(tokBegin[0], tokEnd[0], &orbitRadius) ||
+        !ParseCatalogFloat(tokBegin[1], tokEnd[1], &angularSpeed) ||
+        !ParseCatalogFloat(tokBegin[2], tokEnd[2], &radius))
+    {
+        *err = "malformed orbit, speed or radius";
+        return -1;
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        if (!ParseCatalogInt(tokBegin[3 + c], tokEnd[3 + c], &rgb[c]))
+        {
+            *err = "malformed color component";
+            return -1;
+        }
+        ClampColorInt(&rgb[c]);
+    }
+
+    char name[64];
+    size_t nameLen = (size_t)(p - line);
+    if (nameLen > sizeof(name) - 1)
+        nameLen = sizeof(name) - 1;
+    memcpy(name, line, nameLen);
+    name[nameLen] = '\0';
+    InitPlanet(out, name, orbitRadius, angularSpeed, radius, rgb[0], rgb[1], rgb[2]);
+    return 1;
+}
+
+typedef struct
+{
+    const char *data;
+    size_t size;
+    bool mapped;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+// maps a whole file read-only; falls back to reading it into memory
+static bool MapFileReadOnly(const char *path, MappedFile *mf)
+{
+    memset(mf, 0, sizeof(*mf));
+#ifdef _WIN32
+    mf->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mf->file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(mf->file, &size) && size.QuadPart == 0)
+        {
+            CloseHandle(mf->file);
+            return true;
+        }
+        mf->mapping = CreateFileMappingA(mf->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mf->mapping)
+        {
+            mf->data = (const char *)MapViewOfFile(mf->mapping, FILE_MAP_READ, 0, 0, 0);
+            if (mf->data)
+            {
+                mf->size = (size_t)size.QuadPart;
+                mf->mapped = true;
+                return true;
+            }
+            CloseHandle(mf->mapping);
+        }
+        CloseHandle(mf->file);
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            if (st.st_size == 0)
+            {
+                close(fd);
+                return true;
+            }
+            void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                close(fd);
+                mf->data = (const char *)p;
+                mf->size = (size_t)st.st_size;
+                mf->mapped = true;
+                return true;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+    size_t cap = 1 << 16, len = 0;
+    char *buf = (char *)malloc(cap);
+    size_t got;
+    while (buf && (got = fread(buf + len, 1, cap - len, fp)) > 0)
+    {
+        len += got;
+        if (len == cap)
+        {
+            char *tmp = (char *)realloc(buf, cap * 2);
+            if (!tmp)
+            {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = tmp;
+            cap *= 2;
+        }
+    }
+    fclose(fp);
+    if (!buf)
+        return false;
+    mf->data = buf;
+    mf->size = len;
+    return true;
+}
+
+static void UnmapFile(MappedFile *mf)
+{
+    if (mf->mapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(mf->data);
+        CloseHandle(mf->mapping);
+        CloseHandle(mf->file);
+#else
+        munmap((void *)mf->data, mf->size);
+#endif
+    }
+    else
+    {
+        free((void *)mf->data);
+    }
+    memset(mf, 0, sizeof(*mf));
+}
+
+typedef struct
+{
+    const char *begin;
+    const char *end;
+    Planet *bodies;
+    int count;
+    int capacity;
+    int lines;
+    int errors;
+    int errorLine[CATALOG_MAX_REPORTED_ERRORS]; // relative to the chunk
+    const char *errorMsg[CATALOG_MAX_REPORTED_ERRORS];
+    bool outOfMemory;
+} CatalogChunk;
+
+static int ParseCatalogChunk(void *data)
+{
+    CatalogChunk *chunk = (CatalogChunk *)data;
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    TRACE_THREAD("catalog-parse");
+    TRACE_BEGIN(traceStart);
+    chunk->capacity = (int)((end - p) / 32) + 16;
+    chunk->bodies = (Planet *)malloc(sizeof(Planet) * chunk->capacity);
+    if (!chunk->bodies)
+    {
+        chunk->outOfMemory = true;
+        return 1;
+    }
+
+    while (p < end)
+    {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        if (!nl)
+            nl = end;
+        chunk->lines++;
+        if (chunk->count == chunk->capacity)
+        {
+            Planet *tmp = (Planet *)realloc(chunk->bodies, sizeof(Planet) * chunk->capacity * 2);
+            if (!tmp)
+            {
+                chunk->outOfMemory = true;
+                TRACE_END(traceStart, "parse chunk");
+                return 1;
+            }
+            chunk->bodies = tmp;
+            chunk->capacity *= 2;
+        }
+        const char *err = NULL;
+        int rc = ParseCatalogLine(p, nl, &chunk->bodies[chunk->count], &err);
+        if (rc > 0)
+        {
+            chunk->count++;
+        }
+        else if (rc < 0)
+        {
+            if (chunk->errors < CATALOG_MAX_REPORTED_ERRORS)
+            {
+                chunk->errorLine[chunk->errors] = chunk->lines;
+                chunk->errorMsg[chunk->errors] = err;
+            }
+            chunk->errors++;
+        }
+        p = nl + 1;
+    }
+    TRACE_END(traceStart, "parse chunk");
+    return 0;
+}
+
+static int LoadPlanetsFromTextFile(const char *filename, BodyStore *store)
+{
+    Uint64 ioStart = IoBegin();
+    MappedFile mf;
+    if (!MapFileReadOnly(filename, &mf))
+    {
+        fprintf(stderr, "Failed to open planets file '%s'\n", filename);
+        IoEnd(IO_LOAD_TEXT, filename, ioStart, false);
+        return 0;
+    }
+    BodyStoreClear(store);
+
+    int numChunks = SDL_GetNumLogicalCPUCores();
+    if (numChunks > CATALOG_MAX_WORKERS)
+        numChunks = CATALOG_MAX_WORKERS;
+    if ((size_t)numChunks > mf.size / CATALOG_MIN_CHUNK_BYTES)
+        numChunks = (int)(mf.size / CATALOG_MIN_CHUNK_BYTES);
+    if (numChunks < 1)
+        numChunks = 1;
+
+    // split at newline boundaries so no line straddles two chunks
+    CatalogChunk chunks[CATALOG_MAX_WORKERS];
+    memset(chunks, 0, sizeof(chunks));
+    const char *cursor = mf.data;
+    const char *fileEnd = mf.data + mf.size;
+    for (int i = 0; i < numChunks; i++)
+    {
+        const char *end = (i == numChunks - 1) ? fileEnd : mf.data + mf.size / numChunks * (i + 1);
+        if (end < cursor)
+            end = cursor;
+        const char *nl = end < fileEnd ? (const char *)memchr(end, '\n', (size_t)(fileEnd - end)) : NULL;
+        end = nl ? nl + 1 : fileEnd;
+        chunks[i].begin = cursor;
+        chunks[i].end = end;
+        cursor = end;
+    }
+
+    SDL_Thread *workers[CATALOG_MAX_WORKERS] = {NULL};
+    for (int i = 1; i < numChunks; i++)
+        workers[i] = SDL_CreateThread(ParseCatalogChunk, "catalog-parse", &chunks[i]);
+    ParseCatalogChunk(&chunks[0]);
+    for (int i = 1; i < numChunks; i++)
+    {
+        if (workers[i])
+            SDL_WaitThread(workers[i], NULL);
+        else
+            ParseCatalogChunk(&chunks[i]);
+    }
+
+    int total = 0, errors = 0, lineBase = 0;
+    bool ok = true;
+    for (int i = 0; i < numChunks; i++)
+    {
+        CatalogChunk *c = &chunks[i];
+        ok = ok && !c->outOfMemory;
+        for (int e = 0; e < c->errors && e < CATALOG_MAX_REPORTED_ERRORS; e++)
+        {
+            if (errors + e < CATALOG_MAX_REPORTED_ERRORS)
+                fprintf(stderr, "%s:%d: %s\n", filename, lineBase + c->errorLine[e], c->errorMsg[e]);
+        }
+        errors += c->errors;
+        lineBase += c->lines;
+        total += c->count;
+    }
+    if (errors > CATALOG_MAX_REPORTED_ERRORS)
+        fprintf(stderr, "%s: %d more malformed lines not shown\n",
+                filename, errors - CATALOG_MAX_REPORTED_ERRORS);
+    MetricsNoteMalformed(errors);
+
+    if (ok && !BodyStoreReserve(store, total))
+        ok = false;
+    for (int i = 0; i < numChunks; i++)
+    {
+        if (ok)
+            BodyStoreAddMany(store, chunks[i].bodies, chunks[i].count);
+        free(chunks[i].bodies);
+    }
+    UnmapFile(&mf);
+    IoEnd(IO_LOAD_TEXT, filename, ioStart, ok);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Out of memory loading '%s'\n", filename);
+        BodyStoreClear(store);
+        return 0;
+    }
+    return (store->count > 0);
+}
+
+// uses the name index when it is current and falls back to a scan otherwise
+static void ResolveMoonParents(struct Moon *moons,
+                               int numMoons,
+                               const BodyStore *store,
+                               const NameIndex *names)
+{
+    bool indexed = names && NameIndexInSync(names, store);
+    for (int i = 0; i < numMoons; i++)
+    {
+        BodyHandle none = {0, 0};
+        moons[i].parent = none;
+        if (indexed)
+        {
+            int first;
+            int n = NameIndexFindPrefix(names, store, moons[i].parentName, &first);
+            for (int k = first; k < first + n; k++)
+            {
+                const NameIndexEntry *e = &names->entries[k];
+                if (strcmp(moons[i].parentName, NameIndexEntryName(store, e)) == 0)
+                {
+                    moons[i].parent = e->handle;
+                    break;
+                }
+            }
+            continue;
+        }
+        for (int p = 0; p < store->count; p++)
+        {
+            if (strcmp(moons[i].parentName, store->bodies[p].name) == 0)
+            {
+                moons[i].parent = BodyStoreHandleAt(store, p);
+                break;
+            }
+        }
+    }
+}
+
+static int PlanetFromFields(TextField fields[FIELD_COUNT], Planet *outPlanet)
+{
+    const char *name = fields[FIELD_NAME].text;
+    const char *orbitS = fields[FIELD_ORBIT].text;
+    const char *speedS = fields[FIELD_SPEED].text;
+    const char *radS = fields[FIELD_RADIUS].text;
+    const char *rS = fields[FIELD_R].text;
+    const char *gS = fields[FIELD_G].text;
+    const char *bS = fields[FIELD_B].text;
+
+    if (name[0] == '\0')
+    {
+        fprintf(stderr, "Name cannot be empty.\n");
+        return 0;
+    }
+
+    float orbitRadius = (float)atof(orbitS);
+    float angularSpeed = (float)atof(speedS);
+    float radius = (float)atof(radS);
+    int r = atoi(rS);
+    int g = atoi(gS);
+    int b = atoi(bS);
+    ClampColorInt(&r);
+    ClampColorInt(&g);
+    ClampColorInt(&b);
+
+    InitPlanet(outPlanet, name, orbitRadius, angularSpeed, radius, r, g, b);
+    return 1;
+}
+
+#define CATALOG_PATH_MAX 1024
+#define CATALOG_RECORD_MAX 192
+#define CATALOG_WRITE_BUFFER (1 << 20)
+
+static int FormatCatalogRecord(const Planet *p, char *buf, size_t size)
+{
+    return snprintf(buf, size, "%s %.3f %.5f %.3f %d %d %d",
+                    p->name, p->orbitRadius, p->angularSpeed, p->circle.radius,
+                    p->circle.r, p->circle.g, p->circle.b);
+}
+
+static Uint64 HashName(const char *s)
+{
+    Uint64 h = 0xcbf29ce484222325ull;
+    for (; *s; s++)
+        h = (h ^ (Uint8)*s) * 0x100000001b3ull;
+    return h;
+}
+
+static Uint64 MixKey(Uint64 x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+static int HashTableSize(int n)
+{
+    int size = 16;
+    while (size < n * 2)
+        size *= 2;
+    return size;
+}
+
+static bool GrowArray(void **arr, int *cap, int count, size_t elemSize)
+{
+    if (count < *cap)
+        return true;
+    int newCap = *cap > 0 ? *cap * 2 : 64;
+    void *tmp = realloc(*arr, elemSize * newCap);
+    if (!tmp)
+        return false;
+    *arr = tmp;
+    *cap = newCap;
+    return true;
+}
+
+// flushes stdio and the OS cache for fp
+static bool SyncFile(FILE *fp)
+{
+    if (fflush(fp) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+// a file written next to its destination and renamed over it on commit, so
+// readers and crashes see either the old contents or the new, never a mix
+typedef struct
+{
+    const char *path;
+    char tmpPath[CATALOG_PATH_MAX];
+    FILE *fp;
+    char *buffer;
+} AtomicFile;
+
+static void AtomicFileAbort(AtomicFile *af)
+{
+    if (af->fp)
+    {
+        fclose(af->fp);
+        remove(af->tmpPath);
+    }
+    free(af->buffer);
+    memset(af, 0, sizeof(*af));
+}
+
+static bool AtomicFileOpen(AtomicFile *af, const char *path)
+{
+    memset(af, 0, sizeof(*af));
+    af->path = path;
+    if (snprintf(af->tmpPath, sizeof(af->tmpPath), "%s.tmp", path) >= (int)sizeof(af->tmpPath))
+    {
+        fprintf(stderr, "Path too long: '%s'\n", path);
+        return false;
+    }
+    af->fp = fopen(af->tmpPath, "wb");
+    if (!af->fp)
+    {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", af->tmpPath);
+        return false;
+    }
+    af->buffer = (char *)malloc(CATALOG_WRITE_BUFFER);
+    if (af->buffer)
+        setvbuf(af->fp, af->buffer, _IOFBF, CATALOG_WRITE_BUFFER);
+    return true;
+}
+
+static bool AtomicFileCommit(AtomicFile *af)
+{
+    bool ok = !ferror(af->fp) && SyncFile(af->fp);
+    ok = (fclose(af->fp) == 0) && ok;
+    af->fp = NULL;
+    free(af->buffer);
+    af->buffer = NULL;
+    if (ok)
+    {
+#ifdef _WIN32
+        ok = MoveFileExA(af->tmpPath, af->path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        ok = rename(af->tmpPath, af->path) == 0;
+#endif
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write '%s'; the previous file is unchanged.\n", af->path);
+        remove(af->tmpPath);
+        return false;
+    }
+#ifndef _WIN32
+    // make the rename itself durable
+    char dir[CATALOG_PATH_MAX];
+    SDL_strlcpy(dir, af->path, sizeof(dir));
+    char *slash = strrchr(dir, '/');
+    if (slash)
+        *(slash == dir ? slash + 1 : slash) = '\0';
+    else
+        SDL_strlcpy(dir, ".", sizeof(dir));
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+    return true;
+}
+
+// Text catalogs are never rewritten in place by an edit. Edits are appended
+// to "<catalog>.journal" as "+ seq record" or "- seq record" lines and
+// replayed on load; compaction folds them into the catalog through an
+// AtomicFile. A compacted catalog starts with "# journal seq", the last
+// entry it already contains, so a crash between the two renames replays
+// nothing twice.
+#define JOURNAL_COMPACT_ENTRIES 512
+#define JOURNAL_MARK "# journal "
+
+typedef struct
+{
+    bool add;
+    bool cancelled; // an add and a later remove of the same record cancel out
+    Uint64 seq;
+    Uint64 nameHash;
+    Planet body;
+    char record[CATALOG_RECORD_MAX];
+} JournalEntry;
+
+typedef struct
+{
+    JournalEntry *entries;
+    int count;
+    int capacity;
+    Uint64 lastSeq;
+    long consumed; // bytes of complete lines read
+    int *head;     // removals by name hash, chained through next
+    int *next;
+    int tableSize;
+    int pendingRemovals;
+} CatalogJournal;
+
+static void FreeCatalogJournal(CatalogJournal *j)
+{
+    free(j->entries);
+    free(j->head);
+    free(j->next);
+    memset(j, 0, sizeof(*j));
+}
+
+static Uint64 ReadCatalogJournalMark(const char *path)
+{
+    char line[64];
+    Uint64 seq = 0;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return 0;
+    if (fgets(line, sizeof(line), fp) && strncmp(line, JOURNAL_MARK, strlen(JOURNAL_MARK)) == 0)
+        seq = strtoull(line + strlen(JOURNAL_MARK), NULL, 10);
+    fclose(fp);
+    return seq;
+}
+
+// reads the complete entries after sinceSeq; a torn last line is left for later
+static bool ReadCatalogJournal(const char *path, Uint64 sinceSeq, CatalogJournal *j)
+{
+    memset(j, 0, sizeof(*j));
+    j->lastSeq = sinceSeq;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return true;
+
+    char line[CATALOG_RECORD_MAX + 32];
+    int lineNo = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp))
+    {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n')
+            break;
+        lineNo++;
+        j->consumed += (long)len;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+
+        char *rest = NULL;
+        Uint64 seq = (line[0] == '+' || line[0] == '-') ? strtoull(line + 1, &rest, 10) : 0;
+        Planet body;
+        const char *err = "expected: +|- seq record";
+        if (seq == 0 || !rest || *rest != ' ' || ParseCatalogLine(rest + 1, line + len, &body, &err) != 1)
+        {
+            fprintf(stderr, "%s:%d: %s\n", path, lineNo, err);
+            continue;
+        }
+        if (seq <= sinceSeq)
+            continue;
+        if (!GrowArray((void **)&j->entries, &j->capacity, j->count, sizeof(JournalEntry)))
+        {
+            ok = false;
+            break;
+        }
+        JournalEntry *e = &j->entries[j->count++];
+        e->add = line[0] == '+';
+        e->cancelled = false;
+        e->seq = seq;
+        e->body = body;
+        e->nameHash = HashName(body.name);
+        SDL_strlcpy(e->record, rest + 1, sizeof(e->record));
+        if (seq > j->lastSeq)
+            j->lastSeq = seq;
+    }
+    fclose(fp);
+    if (!ok)
+    {
+        fprintf(stderr, "Out of memory reading '%s'\n", path);
+        FreeCatalogJournal(j);
+    }
+    return ok;
+}
+
+// cancels adds removed later in the journal and indexes the removals that are
+// left, which apply to the catalog itself
+static bool IndexCatalogJournal(CatalogJournal *j)
+{
+    j->tableSize = HashTableSize(j->count);
+    j->head = (int *)malloc(sizeof(int) * j->tableSize);
+    j->next = (int *)malloc(sizeof(int) * (j->count > 0 ? j->count : 1));
+    if (!j->head || !j->next)
+        return false;
+
+    Uint64 mask = (Uint64)(j->tableSize - 1);
+    memset(j->head, 0xff, sizeof(int) * j->tableSize);
+    for (int i = 0; i < j->count; i++)
+    {
+        JournalEntry *e = &j->entries[i];
+        int bucket = (int)(MixKey(e->nameHash) & mask);
+        if (!e->add)
+        {
+            for (int k = j->head[bucket]; k >= 0; k = j->next[k])
+            {
+                JournalEntry *a = &j->entries[k];
+                if (a->add && !a->cancelled && a->nameHash == e->nameHash &&
+                    strcmp(a->record, e->record) == 0)
+                {
+                    a->cancelled = e->cancelled = true;
+                    break;
+                }
+            }
+            if (e->cancelled)
+                continue;
+        }
+        j->next[i] = j->head[bucket];
+        j->head[bucket] = i;
+    }
+
+    // keep only the outstanding removals on the chains
+    memset(j->head, 0xff, sizeof(int) * j->tableSize);
+    j->pendingRemovals = 0;
+    for (int i = j->count - 1; i >= 0; i--)
+    {
+        JournalEntry *e = &j->entries[i];
+        if (e->add || e->cancelled)
+            continue;
+        int bucket = (int)(MixKey(e->nameHash) & mask);
+        j->next[i] = j->head[bucket];
+        j->head[bucket] = i;
+        j->pendingRemovals++;
+    }
+    return true;
+}
+
+// true if a pending removal matches p, consuming it
+static bool TakeJournalRemoval(CatalogJournal *j, const Planet *p)
+{
+    if (j->pendingRemovals == 0)
+        return false;
+    Uint64 h = HashName(p->name);
+    char record[CATALOG_RECORD_MAX];
+    record[0] = '\0';
+    int *link = &j->head[MixKey(h) & (Uint64)(j->tableSize - 1)];
+    for (; *link >= 0; link = &j->next[*link])
+    {
+        JournalEntry *e = &j->entries[*link];
+        if (e->nameHash != h)
+            continue;
+        if (!record[0])
+            FormatCatalogRecord(p, record, sizeof(record));
+        if (strcmp(e->record, record) == 0)
+        {
+            e->cancelled = true;
+            *link = j->next[*link];
+            j->pendingRemovals--;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int LoadTextCatalog(const char *path, const char *journalPath, BodyStore *store,
+                           Uint64 *lastSeq, int *journalEntries)
+{
+    Uint64 baseSeq = ReadCatalogJournalMark(path);
+    if (!LoadPlanetsFromTextFile(path, store))
+        return 0;
+    printf("Loaded %d planets from '%s'\n", store->count, path);
+
+    CatalogJournal j;
+    if (!ReadCatalogJournal(journalPath, baseSeq, &j) || !IndexCatalogJournal(&j))
+    {
+        FreeCatalogJournal(&j);
+        BodyStoreClear(store);
+        return 0;
+    }
+    if (j.pendingRemovals > 0)
+    {
+        // back to front, so swap-remove only moves bodies already checked
+        for (int i = store->count - 1; i >= 0; i--)
+        {
+            if (TakeJournalRemoval(&j, &store->bodies[i]))
+                BodyStoreRemove(store, BodyStoreHandleAt(store, i));
+        }
+    }
+    for (int i = 0; i < j.count; i++)
+    {
+        if (j.entries[i].add && !j.entries[i].cancelled)
+            BodyStoreAdd(store, &j.entries[i].body);
+    }
+    if (j.count > 0)
+        printf("Replayed %d journal entries from '%s'\n", j.count, journalPath);
+    if (lastSeq)
+        *lastSeq = j.lastSeq;
+    if (journalEntries)
+        *journalEntries = j.count;
+    FreeCatalogJournal(&j);
+    return (store->count > 0);
+}
+
+// writes the catalog with the journal folded in; unchanged lines are copied
+// through byte for byte
+static bool CompactTextCatalog(const char *path, CatalogJournal *j)
+{
+    MappedFile mf;
+    AtomicFile af;
+    if (!MapFileReadOnly(path, &mf))
+    {
+        fprintf(stderr, "Failed to open planets file '%s'\n", path);
+        return false;
+    }
+    if (!AtomicFileOpen(&af, path))
+    {
+        UnmapFile(&mf);
+        return false;
+    }
+
+    fprintf(af.fp, JOURNAL_MARK "%llu\n", (unsigned long long)j->lastSeq);
+    const char *p = mf.data;
+    const char *end = mf.data + mf.size;
+    const char *run = p; // start of the lines not yet written
+    if (p < end && strncmp(p, JOURNAL_MARK, strlen(JOURNAL_MARK)) == 0)
+    {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        p = run = nl ? nl + 1 : end;
+    }
+    while (p < end && j->pendingRemovals > 0)
+    {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        const char *next = nl ? nl + 1 : end;
+        Planet body;
+        const char *err = NULL;
+        if (ParseCatalogLine(p, nl ? nl : end, &body, &err) == 1 && TakeJournalRemoval(j, &body))
+        {
+            fwrite(run, 1, (size_t)(p - run), af.fp);
+            run = next;
+        }
+        p = next;
+    }
+    fwrite(run, 1, (size_t)(end - run), af.fp);
+    if (end > mf.data && end[-1] != '\n')
+        fputc('\n', af.fp);
+    UnmapFile(&mf);
+
+    for (int i = 0; i < j->count; i++)
+    {
+        if (j->entries[i].add && !j->entries[i].cancelled)
+            fprintf(af.fp, "%s\n", j->entries[i].record);
+    }
+    if (j->pendingRemovals > 0)
+        fprintf(stderr, "%s: %d journal removals matched no body\n", path, j->pendingRemovals);
+    return AtomicFileCommit(&af);
+}
+
+// Binary catalog (.bin), little-endian:
+//   BinaryCatalogHeader
+//   BinaryCatalogSection[sectionCount]
+//   sections, each 16-byte aligned and zero padded to a multiple of 16
+// Each section carries a checksum of its padded bytes; the header carries one
+// of the section table.
+#define BINCAT_MAGIC "SSCATBIN"
+#define BINCAT_VERSION 1
+#define BINCAT_ENDIAN_TAG 0x01020304u
+#define BINCAT_ALIGN 16
+
+typedef enum
+{
+    BINCAT_ORBIT = 1,    // float per body
+    BINCAT_SPEED,        // float per body
+    BINCAT_RADIUS,       // float per body
+    BINCAT_COLOR,        // r, g, b, unused per body
+    BINCAT_CATALOG_ID,   // int64 per body
+    BINCAT_NAME_OFFSET,  // uint32 per body plus one end offset, into BINCAT_NAMES
+    BINCAT_NAMES,        // concatenated names, not terminated
+    BINCAT_SECTION_COUNT = BINCAT_NAMES
+} BinaryCatalogSectionId;
+
+typedef struct
+{
+    char magic[8];
+    Uint32 version;
+    Uint32 endianTag;
+    Uint64 bodyCount;
+    Uint32 sectionCount;
+    Uint32 headerSize;
+    Uint64 tableChecksum;
+    Uint8 reserved[24];
+} BinaryCatalogHeader;
+
+typedef struct
+{
+    Uint32 id;
+    Uint32 elemSize;
+    Uint64 offset;
+    Uint64 size; // unpadded
+    Uint64 checksum;
+} BinaryCatalogSection;
+
+static Uint64 BinaryCatalogPadded(Uint64 size)
+{
+    return (size + BINCAT_ALIGN - 1) & ~(Uint64)(BINCAT_ALIGN - 1);
+}
+
+// hashes data as if it were zero padded to BINCAT_ALIGN
+static Uint64 BinaryCatalogChecksum(const void *data, Uint64 size)
+{
+    const Uint8 *p = (const Uint8 *)data;
+    Uint64 padded = BinaryCatalogPadded(size);
+    Uint64 whole = size & ~(Uint64)7;
+    Uint8 tail[8] = {0};
+    memcpy(tail, p + whole, (size_t)(size - whole));
+    Uint64 h = 0x9E3779B97F4A7C15ull ^ padded;
+    for (Uint64 i = 0; i < padded; i += 8)
+    {
+        Uint64 w = 0;
+        if (i < whole)
+            memcpy(&w, p + i, 8);
+        else if (i == whole)
+            memcpy(&w, tail, 8);
+        h ^= w * 0xC2B2AE3D27D4EB4Full;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 32);
+}
+
+static const BinaryCatalogSection *FindBinaryCatalogSection(const MappedFile *mf,
+                                                            const BinaryCatalogHeader *hdr,
+                                                            Uint32 id, Uint64 minSize)
+{
+    const BinaryCatalogSection *table =
+        (const BinaryCatalogSection *)(mf->data + hdr->headerSize);
+    for (Uint32 i = 0; i < hdr->sectionCount; i++)
+    {
+        const BinaryCatalogSection *s = &table[i];
+        if (s->id != id)
+            continue;
+        if (s->offset % BINCAT_ALIGN != 0 || s->size < minSize ||
+            s->offset > mf->size || BinaryCatalogPadded(s->size) > mf->size - s->offset)
+            return NULL;
+        if (BinaryCatalogChecksum(mf->data + s->offset, s->size) != s->checksum)
+            return NULL;
+        return s;
+    }
+    return NULL;
+}
+
+static int LoadPlanetsFromBinaryFile(const char *filename, BodyStore *store)
+{
+    MappedFile mf;
+    if (!MapFileReadOnly(filename, &mf))
+    {
+        fprintf(stderr, "Failed to open planets file '%s'\n", filename);
+        return 0;
+    }
+
+    const char *why = NULL;
+    const BinaryCatalogHeader *hdr = (const BinaryCatalogHeader *)mf.data;
+    if (mf.size < sizeof(*hdr) || memcmp(hdr->magic, BINCAT_MAGIC, 8) != 0)
+        why = "not a binary catalog";
+    else if (hdr->endianTag != BINCAT_ENDIAN_TAG)
+        why = "byte order does not match this machine";
+    else if (hdr->version != BINCAT_VERSION)
+        why = "unsupported version";
+    else if (hdr->headerSize < sizeof(*hdr) || hdr->headerSize % 8 != 0 ||
+             hdr->sectionCount > 64 || hdr->bodyCount > (Uint64)INT_MAX ||
+             hdr->headerSize + (Uint64)hdr->sectionCount * sizeof(BinaryCatalogSection) > mf.size)
+        why = "corrupt header";
+    else if (BinaryCatalogChecksum(mf.data + hdr->headerSize,
+                                   hdr->sectionCount * sizeof(BinaryCatalogSection)) != hdr->tableChecksum)
+        why = "section table checksum mismatch";
+    if (why)
+    {
+        fprintf(stderr, "%s: %s\n", filename, why);
+        UnmapFile(&mf);
+        return 0;
+    }
+
+    Uint64 n = hdr->bodyCount;
+    const BinaryCatalogSection *sOrbit = FindBinaryCatalogSection(&mf, hdr, BINCAT_ORBIT, n * 4);
+    const BinaryCatalogSection *sSpeed = FindBinaryCatalogSection(&mf, hdr, BINCAT_SPEED, n * 4);
+    const BinaryCatalogSection *sRadius = FindBinaryCatalogSection(&mf, hdr, BINCAT_RADIUS, n * 4);
+    const BinaryCatalogSection *sColor = FindBinaryCatalogSection(&mf, hdr, BINCAT_COLOR, n * 4);
+    const BinaryCatalogSection *sId = FindBinaryCatalogSection(&mf, hdr, BINCAT_CATALOG_ID, n * 8);
+    const BinaryCatalogSection *sNameOff = FindBinaryCatalogSection(&mf, hdr, BINCAT_NAME_OFFSET, (n + 1) * 4);
+    const BinaryCatalogSection *sNames = FindBinaryCatalogSection(&mf, hdr, BINCAT_NAMES, 0);
+    if (!sOrbit || !sSpeed || !sRadius || !sColor || !sId || !sNameOff || !sNames)
+    {
+        fprintf(stderr, "%s: missing or corrupt section\n", filename);
+        UnmapFile(&mf);
+        return 0;
+    }
+
+    // columns are read straight out of the mapping
+    const float *orbit = (const float *)(mf.data + sOrbit->offset);
+    const float *speed = (const float *)(mf.data + sSpeed->offset);
+    const float *radius = (const float *)(mf.data + sRadius->offset);
+    const Uint8 *color = (const Uint8 *)(mf.data + sColor->offset);
+    const sqlite3_int64 *ids = (const sqlite3_int64 *)(mf.data + sId->offset);
+    const Uint32 *nameOff = (const Uint32 *)(mf.data + sNameOff->offset);
+    const char *names = mf.data + sNames->offset;
+
+    BodyStoreClear(store);
+    if (!BodyStoreReserve(store, (int)n))
+    {
+        fprintf(stderr, "Out of memory loading '%s'\n", filename);
+        UnmapFile(&mf);
+        return 0;
+    }
+    int bad = 0;
+    for (Uint64 i = 0; i < n; i++)
+    {
+        Uint32 a = nameOff[i], b = nameOff[i + 1];
+        if (a > b || b > sNames->size)
+        {
+            bad++;
+            continue;
+        }
+        char name[64];
+        size_t len = b - a < sizeof(name) - 1 ? b - a : sizeof(name) - 1;
+        memcpy(name, names + a, len);
+        name[len] = '\0';
+        Planet p;
+        InitPlanet(&p, name, orbit[i], speed[i], radius[i],
+                   color[i * 4], color[i * 4 + 1], color[i * 4 + 2]);
+        p.catalogId = ids[i];
+        BodyStoreAdd(store, &p);
+    }
+    UnmapFile(&mf);
+
+    if (bad)
+        fprintf(stderr, "%s: %d bodies with bad name offsets skipped\n", filename, bad);
+    printf("Loaded %d planets from '%s'\n", store->count, filename);
+    return (store->count > 0);
+}
+
+static bool WriteBinaryCatalogSection(FILE *fp, Uint64 *cursor, BinaryCatalogSection *sec,
+                                      Uint32 id, Uint32 elemSize, const void *data, Uint64 size)
+{
+    static const Uint8 zeros[BINCAT_ALIGN] = {0};
+    Uint64 padded = BinaryCatalogPadded(size);
+    sec->id = id;
+    sec->elemSize = elemSize;
+    sec->offset = *cursor;
+    sec->size = size;
+    sec->checksum = BinaryCatalogChecksum(data, size);
+    *cursor += padded;
+    return fwrite(data, 1, (size_t)size, fp) == size &&
+           fwrite(zeros, 1, (size_t)(padded - size), fp) == padded - size;
+}
+
+static int SavePlanetsToBinaryFile(const char *filename, const BodyStore *store)
+{
+    int n = store->count;
+    size_t namesLen = 0;
+    for (int i = 0; i < n; i++)
+        namesLen += strlen(store->bodies[i].name);
+
+    float *orbit = (float *)malloc(sizeof(float) * (n + 1));
+    float *speed = (float *)malloc(sizeof(float) * (n + 1));
+    float *radius = (float *)malloc(sizeof(float) * (n + 1));
+    Uint8 *color = (Uint8 *)malloc(4 * (size_t)(n + 1));
+    sqlite3_int64 *ids = (sqlite3_int64 *)malloc(sizeof(sqlite3_int64) * (n + 1));
+    Uint32 *nameOff = (Uint32 *)malloc(sizeof(Uint32) * (n + 1));
+    char *names = (char *)malloc(namesLen + 1);
+    AtomicFile af;
+    FILE *fp = NULL;
+    int ok = 0;
+    if (!orbit || !speed || !radius || !color || !ids || !nameOff || !names || namesLen > 0xFFFFFFFFu)
+    {
+        fprintf(stderr, "Out of memory writing '%s'\n", filename);
+        goto done;
+    }
+
+    size_t pos = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const Planet *p = &store->bodies[i];
+        orbit[i] = p->orbitRadius;
+        speed[i] = p->angularSpeed;
+        radius[i] = p->circle.radius;
+        color[i * 4] = p->circle.r;
+        color[i * 4 + 1] = p->circle.g;
+        color[i * 4 + 2] = p->circle.b;
+        color[i * 4 + 3] = 0;
+        ids[i] = p->catalogId;
+        nameOff[i] = (Uint32)pos;
+        size_t len = strlen(p->name);
+        memcpy(names + pos, p->name, len);
+        pos += len;
+    }
+    nameOff[n] = (Uint32)pos;
+
+    if (!AtomicFileOpen(&af, filename))
+        goto done;
+    fp = af.fp;
+
+    BinaryCatalogHeader hdr;
+    BinaryCatalogSection table[BINCAT_SECTION_COUNT];
+    memset(&hdr, 0, sizeof(hdr));
+    memset(table, 0, sizeof(table));
+    memcpy(hdr.magic, BINCAT_MAGIC, 8);
+    hdr.version = BINCAT_VERSION;
+    hdr.endianTag = BINCAT_ENDIAN_TAG;
+    hdr.bodyCount = (Uint64)n;
+    hdr.sectionCount = BINCAT_SECTION_COUNT;
+    hdr.headerSize = sizeof(hdr);
+    Uint64 cursor = sizeof(hdr) + sizeof(table);
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fwrite(table, sizeof(table), 1, fp) != 1 ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[0], BINCAT_ORBIT, 4, orbit, (Uint64)n * 4) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[1], BINCAT_SPEED, 4, speed, (Uint64)n * 4) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[2], BINCAT_RADIUS, 4, radius, (Uint64)n * 4) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[3], BINCAT_COLOR, 4, color, (Uint64)n * 4) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[4], BINCAT_CATALOG_ID, 8, ids, (Uint64)n * 8) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[5], BINCAT_NAME_OFFSET, 4, nameOff, (Uint64)(n + 1) * 4) ||
+        !WriteBinaryCatalogSection(fp, &cursor, &table[6], BINCAT_NAMES, 1, names, pos))
+    {
+        fprintf(stderr, "Failed to write '%s'.\n", filename);
+        goto done;
+    }
+    hdr.tableChecksum = BinaryCatalogChecksum(table, sizeof(table));
+    if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        fwrite(table, sizeof(table), 1, fp) != 1)
+    {
+        fprintf(stderr, "Failed to write '%s'.\n", filename);
+        goto done;
+    }
+    ok = AtomicFileCommit(&af);
+    fp = NULL;
+
+done:
+    if (fp)
+        AtomicFileAbort(&af);
+    free(orbit);
+    free(speed);
+    free(radius);
+    free(color);
+    free(ids);
+    free(nameOff);
+    free(names);
+    return ok;
+}
+
+typedef enum
+{
+    CATALOG_TEXT = 0,
+    CATALOG_SQLITE,
+    CATALOG_BINARY
+} CatalogKind;
+
+typedef struct
+{
+    CatalogKind kind;
+    const char *path;
+    sqlite3 *db;
+    sqlite3_stmt *loadStmt;
+    sqlite3_stmt *insertStmt;
+    sqlite3_stmt *deleteStmt;
+    int batchDepth;
+    bool batchFailed;
+    // text catalogs: the edit journal and its background compaction
+    char journalPath[CATALOG_PATH_MAX];
+    FILE *journal;
+    SDL_Mutex *journalLock;
+    Uint64 journalSeq;  // last entry written or loaded
+    int journalEntries; // since the last compaction
+    SDL_Thread *compactor;
+    SDL_AtomicInt compacting;
+} Catalog;
+
+static bool PathHasExtension(const char *path, const char *ext)
+{
+    size_t n = strlen(path);
+    size_t e = strlen(ext);
+    return n > e && SDL_strcasecmp(path + n - e, ext) == 0;
+}
+
+static int CatalogExec(Catalog *cat, const char *sql)
+{
+    char *err = NULL;
+    if (sqlite3_exec(cat->db, sql, NULL, NULL, &err) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQLite error on '%s': %s\n", cat->path, err ? err : "unknown");
+        sqlite3_free(err);
+        return 0;
+    }
+    return 1;
+}
+
+static int CatalogPrepare(Catalog *cat, const char *sql, sqlite3_stmt **out)
+{
+    if (sqlite3_prepare_v3(cat->db, sql, -1, SQLITE_PREPARE_PERSISTENT, out, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Failed to prepare statement on '%s': %s\n",
+                cat->path, sqlite3_errmsg(cat->db));
+        return 0;
+    }
+    return 1;
+}
+
+// fsyncs the journal; called with journalLock held
+static bool SyncCatalogJournal(Catalog *cat)
+{
+    return !cat->journal || SyncFile(cat->journal);
+}
+
+// drops the first consumed bytes of the journal; called with journalLock held
+static bool TrimCatalogJournal(Catalog *cat, long consumed, int *remaining)
+{
+    *remaining = 0;
+    if (cat->journal)
+    {
+        fclose(cat->journal);
+        cat->journal = NULL;
+    }
+    FILE *in = fopen(cat->journalPath, "rb");
+    if (!in)
+        return true;
+    long size = (fseek(in, 0, SEEK_END) == 0) ? ftell(in) : -1;
+    if (size >= 0 && size <= consumed)
+    {
+        fclose(in);
+        return remove(cat->journalPath) == 0;
+    }
+    AtomicFile af;
+    if (size < 0 || fseek(in, consumed, SEEK_SET) != 0 || !AtomicFileOpen(&af, cat->journalPath))
+    {
+        fclose(in);
+        return false;
+    }
+    char buf[1 << 16];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        fwrite(buf, 1, got, af.fp);
+        for (size_t i = 0; i < got; i++)
+            *remaining += buf[i] == '\n';
+    }
+    fclose(in);
+    return AtomicFileCommit(&af);
+}
+
+static int CatalogCompactThread(void *data)
+{
+    Catalog *cat = (Catalog *)data;
+    TRACE_THREAD("catalog-compact");
+    TRACE_BEGIN(traceStart);
+    Uint64 baseSeq = ReadCatalogJournalMark(cat->path);
+    CatalogJournal j;
+    SDL_LockMutex(cat->journalLock);
+    bool ok = SyncCatalogJournal(cat) && ReadCatalogJournal(cat->journalPath, baseSeq, &j);
+    SDL_UnlockMutex(cat->journalLock);
+    if (!ok)
+        memset(&j, 0, sizeof(j));
+
+    // the slow part runs unlocked; edits made meanwhile land after j.consumed
+    ok = ok && IndexCatalogJournal(&j) && CompactTextCatalog(cat->path, &j);
+
+    int remaining = 0;
+    SDL_LockMutex(cat->journalLock);
+    if (ok)
+        ok = TrimCatalogJournal(cat, j.consumed, &remaining);
+    cat->journalEntries = remaining;
+    SDL_UnlockMutex(cat->journalLock);
+    if (ok)
+        printf("Compacted %d journal entries into '%s'\n", j.count, cat->path);
+    else
+        fprintf(stderr, "Failed to compact journal '%s'\n", cat->journalPath);
+    FreeCatalogJournal(&j);
+    TRACE_END(traceStart, "compact journal");
+    SDL_SetAtomicInt(&cat->compacting, 0);
+    return ok ? 0 : 1;
+}
+
+// starts a background compaction once enough journal entries have piled up
+static void CatalogMaybeCompact(Catalog *cat)
+{
+    if (cat->kind != CATALOG_TEXT || SDL_GetAtomicInt(&cat->compacting))
+        return;
+    if (cat->compactor)
+    {
+        SDL_WaitThread(cat->compactor, NULL);
+        cat->compactor = NULL;
+    }
+    SDL_LockMutex(cat->journalLock);
+    int entries = cat->journalEntries;
+    SDL_UnlockMutex(cat->journalLock);
+    if (entries < JOURNAL_COMPACT_ENTRIES)
+        return;
+    SDL_SetAtomicInt(&cat->compacting, 1);
+    cat->compactor = SDL_CreateThread(CatalogCompactThread, "catalog-compact", cat);
+    if (!cat->compactor)
+    {
+        fprintf(stderr, "Failed to start journal compaction: %s\n", SDL_GetError());
+        SDL_SetAtomicInt(&cat->compacting, 0);
+    }
+}
+
+// inside a batch the journal is synced once, by CatalogEndBatch
+static int CatalogJournalAppend(Catalog *cat, bool add, const Planet *p)
+{
+    char record[CATALOG_RECORD_MAX];
+    FormatCatalogRecord(p, record, sizeof(record));
+    SDL_LockMutex(cat->journalLock);
+    if (!cat->journal)
+        cat->journal = fopen(cat->journalPath, "ab");
+    bool ok = cat->journal &&
+              fprintf(cat->journal, "%c %llu %s\n", add ? '+' : '-',
+                      (unsigned long long)(cat->journalSeq + 1), record) > 0 &&
+              (cat->batchDepth > 0 || SyncCatalogJournal(cat));
+    if (ok)
+    {
+        cat->journalSeq++;
+        cat->journalEntries++;
+    }
+    SDL_UnlockMutex(cat->journalLock);
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write journal '%s'\n", cat->journalPath);
+        return 0;
+    }
+    if (cat->batchDepth == 0)
+        CatalogMaybeCompact(cat);
+    return 1;
+}
+
+static void CatalogClose(Catalog *cat)
+{
+    if (cat->compactor)
+        SDL_WaitThread(cat->compactor, NULL);
+    if (cat->journal)
+    {
+        SyncCatalogJournal(cat);
+        fclose(cat->journal);
+    }
+    SDL_DestroyMutex(cat->journalLock);
+    if (cat->db)
+    {
+        if (cat->batchDepth > 0)
+            CatalogExec(cat, "COMMIT");
+        sqlite3_finalize(cat->loadStmt);
+        sqlite3_finalize(cat->insertStmt);
+        sqlite3_finalize(cat->deleteStmt);
+        sqlite3_close(cat->db);
+    }
+    memset(cat, 0, sizeof(*cat));
+}
+
+// .db files use the SQLite backend, .bin the binary format, anything else
+// is read as planets.txt format
+static int CatalogOpen(Catalog *cat, const char *path)
+{
+    memset(cat, 0, sizeof(*cat));
+    cat->path = path;
+    if (PathHasExtension(path, ".db"))
+        cat->kind = CATALOG_SQLITE;
+    else if (PathHasExtension(path, ".bin"))
+        cat->kind = CATALOG_BINARY;
+    else
+        cat->kind = CATALOG_TEXT;
+    if (cat->kind == CATALOG_TEXT)
+    {
+        if (snprintf(cat->journalPath, sizeof(cat->journalPath), "%s.journal", path) >=
+            (int)sizeof(cat->journalPath))
+        {
+            fprintf(stderr, "Path too long: '%s'\n", path);
+            return 0;
+        }
+        cat->journalLock = SDL_CreateMutex();
+        return cat->journalLock != NULL;
+    }
+    if (cat->kind != CATALOG_SQLITE)
+        return 1;
+
+    if (sqlite3_open_v2(path, &cat->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Failed to open catalog '%s': %s\n", path,
+                cat->db ? sqlite3_errmsg(cat->db) : "out of memory");
+        CatalogClose(cat);
+        return 0;
+    }
+    if (!CatalogExec(cat, "PRAGMA journal_mode=WAL;"
+                          "PRAGMA synchronous=NORMAL;"
+                          "CREATE TABLE IF NOT EXISTS \"planets\" ("
+                          "\"id\" INTEGER NOT NULL,"
+                          "\"name\" TEXT NOT NULL,"
+                          "\"orbit_radius\" REAL NOT NULL,"
+                          "\"angular_speed\" REAL NOT NULL,"
+                          "\"radius\" REAL NOT NULL,"
+                          "\"color_r\" INTEGER NOT NULL,"
+                          "\"color_g\" INTEGER NOT NULL,"
+                          "\"color_b\" INTEGER NOT NULL,"
+                          "\"texture_url\" INTEGER,"
+                          "PRIMARY KEY(\"id\" AUTOINCREMENT));"
+                          "CREATE INDEX IF NOT EXISTS planets_orbit_radius_idx"
+                          " ON planets(orbit_radius, radius);"
+                          "CREATE INDEX IF NOT EXISTS planets_radius_idx ON planets(radius);") ||
+        !CatalogPrepare(cat,
+                        "SELECT id, name, orbit_radius, angular_speed, radius,"
+                        " color_r, color_g, color_b FROM planets ORDER BY id",
+                        &cat->loadStmt) ||
+        !CatalogPrepare(cat,
+                        "INSERT INTO planets (name, orbit_radius, angular_speed, radius,"
+                        " color_r, color_g, color_b) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)",
+                        &cat->insertStmt) ||
+        !CatalogPrepare(cat, "DELETE FROM planets WHERE id = ?1", &cat->deleteStmt))
+    {
+        CatalogClose(cat);
+        return 0;
+    }
+    return 1;
+}
+
+// edits between Begin/End share one transaction; nesting is allowed. Nothing
+// may be edited when Begin fails.
+static bool CatalogBeginBatch(Catalog *cat)
+{
+    if (cat->batchDepth == 0)
+    {
+        if (cat->kind == CATALOG_SQLITE && !CatalogExec(cat, "BEGIN IMMEDIATE"))
+            return false;
+        cat->batchFailed = false;
+    }
+    cat->batchDepth++;
+    return true;
+}
+
+// ok false abandons the batch: a SQLite transaction is rolled back, while
+// journal records already written stay. Returns whether the outermost batch
+// was stored, so false when a commit, a journal sync or any nested batch failed.
+static bool CatalogEndBatch(Catalog *cat, bool ok)
+{
+    if (cat->batchDepth == 0)
+        return false;
+    if (!ok)
+        cat->batchFailed = true;
+    if (--cat->batchDepth > 0)
+        return !cat->batchFailed;
+    bool stored = !cat->batchFailed;
+    if (cat->kind == CATALOG_SQLITE)
+    {
+        if (stored && !CatalogExec(cat, "COMMIT"))
+            stored = false;
+        if (!stored)
+            CatalogExec(cat, "ROLLBACK");
+    }
+    else if (cat->kind == CATALOG_TEXT)
+    {
+        SDL_LockMutex(cat->journalLock);
+        if (!SyncCatalogJournal(cat))
+        {
+            fprintf(stderr, "Failed to write journal '%s'\n", cat->journalPath);
+            stored = false;
+        }
+        SDL_UnlockMutex(cat->journalLock);
+        CatalogMaybeCompact(cat);
+    }
+    return stored;
+}
+
+static int CatalogLoad(Catalog *cat, BodyStore *store)
+{
+    if (cat->kind == CATALOG_TEXT)
+    {
+        if (!LoadTextCatalog(cat->path, cat->journalPath, store, &cat->journalSeq, &cat->journalEntries))
+            return 0;
+        CatalogMaybeCompact(cat);
+        return 1;
+    }
+    if (cat->kind == CATALOG_BINARY)
+        return LoadPlanetsFromBinaryFile(cat->path, store);
+
+    BodyStoreClear(store);
+    sqlite3_stmt *st = cat->loadStmt;
+    int rc;
+    while ((rc = sqlite3_step(st)) == SQLITE_ROW)
+    {
+        const unsigned char *name = sqlite3_column_text(st, 1);
+        int r = sqlite3_column_int(st, 5);
+        int g = sqlite3_column_int(st, 6);
+        int b = sqlite3_column_int(st, 7);
+        ClampColorInt(&r);
+        ClampColorInt(&g);
+        ClampColorInt(&b);
+        Planet p;
+        InitPlanet(&p, name ? (const char *)name : "",
+                   (float)sqlite3_column_double(st, 2),
+                   (float)sqlite3_column_double(st, 3),
+                   (float)sqlite3_column_double(st, 4),
+                   r, g, b);
+        p.catalogId = sqlite3_column_int64(st, 0);
+        if (BodyStoreAdd(store, &p).generation == 0)
+        {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+    }
+    sqlite3_reset(st);
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Failed to load catalog '%s': %s\n", cat->path, sqlite3_errmsg(cat->db));
+        BodyStoreClear(store);
+        return 0;
+    }
+    printf("Loaded %d planets from '%s'\n", store->count, cat->path);
+    return (store->count > 0);
+}
+
+static int CatalogAdd(Catalog *cat, Planet *p)
+{
+    if (cat->kind == CATALOG_BINARY)
+    {
+        fprintf(stderr, "Binary catalog '%s' is read-only; edit the source catalog and convert it again.\n",
+                cat->path);
+        return 0;
+    }
+    TRACE_BEGIN(traceStart);
+    Uint64 ioStart = IoBegin();
+    if (cat->kind == CATALOG_TEXT)
+    {
+        int ok = CatalogJournalAppend(cat, true, p);
+        TRACE_END(traceStart, "catalog add");
+        IoEnd(IO_CATALOG_ADD, cat->path, ioStart, ok);
+        if (!ok)
+            return 0;
+        printf("Added planet: %s\n", p->name);
+        return 1;
+    }
+
+    sqlite3_stmt *st = cat->insertStmt;
+    sqlite3_bind_text(st, 1, p->name, -1, SQLITE_STATIC);
+    sqlite3_bind_double(st, 2, p->orbitRadius);
+    sqlite3_bind_double(st, 3, p->angularSpeed);
+    sqlite3_bind_double(st, 4, p->circle.radius);
+    sqlite3_bind_int(st, 5, p->circle.r);
+    sqlite3_bind_int(st, 6, p->circle.g);
+    sqlite3_bind_int(st, 7, p->circle.b);
+    int rc = sqlite3_step(st);
+    sqlite3_reset(st);
+    sqlite3_clear_bindings(st);
+    TRACE_END(traceStart, "catalog add");
+    IoEnd(IO_CATALOG_ADD, cat->path, ioStart, rc == SQLITE_DONE);
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Failed to insert '%s': %s\n", p->name, sqlite3_errmsg(cat->db));
+        return 0;
+    }
+    p->catalogId = sqlite3_last_insert_rowid(cat->db);
+    printf("Added planet: %s\n", p->name);
+    return 1;
+}
+
+// deletes p's row from the catalog; the caller removes it from the store
+static int CatalogDeleteRow(Catalog *cat, const Planet *p)
+{
+    if (cat->kind == CATALOG_TEXT)
+        return CatalogJournalAppend(cat, false, p);
+
+    sqlite3_stmt *st = cat->deleteStmt;
+    sqlite3_bind_int64(st, 1, p->catalogId);
+    int rc = sqlite3_step(st);
+    sqlite3_reset(st);
+    if (rc != SQLITE_DONE)
+    {
+        fprintf(stderr, "Failed to delete '%s': %s\n", p->name, sqlite3_errmsg(cat->db));
+        return 0;
+    }
+    return 1;
+}
+
+// removes all of handles in one batch, so one transaction or one journal
+// sync; returns how many were removed. Bodies leave the store only once the
+// batch is stored: a failed SQLite batch removes none, while a text catalog
+// removes those whose journal records were written.
+static int CatalogRemoveMany(Catalog *cat, BodyStore *store, const BodyHandle *handles, int n)
+{
+    if (cat->kind == CATALOG_BINARY)
+    {
+        fprintf(stderr, "Binary catalog '%s' is read-only; edit the source catalog and convert it again.\n",
+                cat->path);
+        return 0;
+    }
+    TRACE_BEGIN(traceStart);
+    Uint64 ioStart = IoBegin();
+    bool begun = CatalogBeginBatch(cat);
+    bool ok = begun;
+    int written = 0; // handles before this one have had their rows deleted
+    while (ok && written < n)
+    {
+        Planet *p = BodyStoreGet(store, handles[written]);
+        if (p && !CatalogDeleteRow(cat, p))
+            ok = false;
+        else
+            written++;
+    }
+    if (begun && !CatalogEndBatch(cat, ok))
+        ok = false;
+    if (!ok && cat->kind == CATALOG_SQLITE)
+        written = 0; // rolled back
+    int removed = 0;
+    for (int i = 0; i < written; i++)
+    {
+        if (BodyStoreGet(store, handles[i]))
+        {
+            BodyStoreRemove(store, handles[i]);
+            removed++;
+        }
+    }
+    TRACE_END(traceStart, "catalog remove");
+    IoEnd(IO_CATALOG_REMOVE, cat->path, ioStart, ok);
+    if (!ok)
+        fprintf(stderr, "Removing %d planets from '%s' failed; %d removed\n", n, cat->path, removed);
+    else
+        printf("Removed %d planets\n", removed);
+    return removed;
+}
+
+// catalogs bigger than this are streamed in by the paged loader instead of loaded whole
+#define PAGED_LOAD_THRESHOLD 200000
+#define PAGER_MAX_BANDS 256
+#define PAGER_BAND_BASE 16.0f
+#define PAGER_BAND_RATIO 1.125f
+#define PAGER_PAGE_LIMIT 20000
+#define PAGER_BODY_BUDGET 250000
+#define PAGER_MIN_PIXELS 0.5f
+#define PAGER_QUEUE_SIZE 64
+
+// one page per orbit band; lod is the log2 of the smallest body radius it holds
+typedef struct
+{
+    bool resident;
+    bool pending;
+    int lod;
+    Uint64 lastUsed;
+    BodyHandle *handles;
+    int count;
+} CatalogPage;
+
+typedef struct PageResult
+{
+    int band;
+    int lod;
+    Planet *bodies;
+    int count;
+    struct PageResult *next;
+} PageResult;
+
+typedef struct
+{
+    const char *path;
+    SDL_Thread *thread;
+    SDL_Mutex *lock;
+    SDL_Condition *wake;
+    bool running;
+    bool quit;
+    int queueBand[PAGER_QUEUE_SIZE];
+    int queueLod[PAGER_QUEUE_SIZE];
+    int queueHead;
+    int queueCount;
+    PageResult *results;
+    CatalogPage pages[PAGER_MAX_BANDS];
+    int residentBodies;
+    float maxOrbit;
+    Uint64 ticks; // simulation ticks, used to phase bodies that stream in late
+} PagedLoader;
+
+static int PagerBandForOrbit(float orbitRadius)
+{
+    if (orbitRadius < PAGER_BAND_BASE)
+        return 0;
+    int band = 1 + (int)(logf(orbitRadius / PAGER_BAND_BASE) / logf(PAGER_BAND_RATIO));
+    return band < PAGER_MAX_BANDS ? band : PAGER_MAX_BANDS - 1;
+}
+
+static float PagerBandLower(int band)
+{
+    return band == 0 ? 0.0f : PAGER_BAND_BASE * powf(PAGER_BAND_RATIO, (float)(band - 1));
+}
+
+static float PagerBandUpper(int band)
+{
+    return band == PAGER_MAX_BANDS - 1 ? 3.0e38f : PAGER_BAND_BASE * powf(PAGER_BAND_RATIO, (float)band);
+}
+
+static int PagerThread(void *data)
+{
+    PagedLoader *pl = (PagedLoader *)data;
+    TRACE_THREAD("catalog-pager");
+    sqlite3 *db = NULL;
+    sqlite3_stmt *st = NULL;
+    if (sqlite3_open_v2(pl->path, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v3(db,
+                           "SELECT id, name, orbit_radius, angular_speed, radius,"
+                           " color_r, color_g, color_b FROM planets"
+                           " WHERE orbit_radius >= ?1 AND orbit_radius < ?2 AND radius >= ?3"
+                           " ORDER BY radius DESC LIMIT ?4",
+                           -1, SQLITE_PREPARE_PERSISTENT, &st, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "Paged loader failed to open '%s': %s\n", pl->path,
+                db ? sqlite3_errmsg(db) : "out of memory");
+        sqlite3_close(db);
+        return 1;
+    }
+
+    SDL_LockMutex(pl->lock);
+    while (!pl->quit)
+    {
+        if (pl->queueCount == 0)
+        {
+            SDL_WaitCondition(pl->wake, pl->lock);
+            continue;
+        }
+        int band = pl->queueBand[pl->queueHead];
+        int lod = pl->queueLod[pl->queueHead];
+        pl->queueHead = (pl->queueHead + 1) % PAGER_QUEUE_SIZE;
+        pl->queueCount--;
+        SDL_UnlockMutex(pl->lock);
+
+        TRACE_BEGIN(traceStart);
+        PageResult *res = (PageResult *)calloc(1, sizeof(PageResult));
+        Planet *bodies = (Planet *)malloc(sizeof(Planet) * PAGER_PAGE_LIMIT);
+        if (res && bodies)
+        {
+            res->band = band;
+            res->lod = lod;
+            res->bodies = bodies;
+            sqlite3_bind_double(st, 1, PagerBandLower(band));
+            sqlite3_bind_double(st, 2, PagerBandUpper(band));
+            sqlite3_bind_double(st, 3, ldexp(1.0, lod));
+            sqlite3_bind_int(st, 4, PAGER_PAGE_LIMIT);
+            while (sqlite3_step(st) == SQLITE_ROW)
+            {
+                const unsigned char *name = sqlite3_column_text(st, 1);
+                int r = sqlite3_column_int(st, 5);
+                int g = sqlite3_column_int(st, 6);
+                int b = sqlite3_column_int(st, 7);
+                ClampColorInt(&r);
+                ClampColorInt(&g);
+                ClampColorInt(&b);
+                Planet *p = &bodies[res->count++];
+                InitPlanet(p, name ? (const char *)name : "",
+                           (float)sqlite3_column_double(st, 2),
+                           (float)sqlite3_column_double(st, 3),
+                           (float)sqlite3_column_double(st, 4),
+                           r, g, b);
+                p->catalogId = sqlite3_column_int64(st, 0);
+            }
+            sqlite3_reset(st);
+        }
+        else
+        {
+            free(bodies);
+            free(res);
+            res = NULL;
+        }
+        TRACE_END(traceStart, "load page");
+
+        SDL_LockMutex(pl->lock);
+        if (res)
+        {
+            res->next = pl->results;
+            pl->results = res;
+        }
+        else
+        {
+            // let the main thread ask for this band again
+            pl->pages[band].pending = false;
+        }
+    }
+    SDL_UnlockMutex(pl->lock);
+
+    sqlite3_finalize(st);
+    sqlite3_close(db);
+    return 0;
+}
+
+static sqlite3_int64 CatalogCountRows(Catalog *cat)
+{
+    sqlite3_int64 n = 0;
+    sqlite3_stmt *st = NULL;
+    if (cat->kind != CATALOG_SQLITE ||
+        sqlite3_prepare_v2(cat->db, "SELECT count(*) FROM planets", -1, &st, NULL) != SQLITE_OK)
+        return 0;
+    if (sqlite3_step(st) == SQLITE_ROW)
+        n = sqlite3_column_int64(st, 0);
+    sqlite3_finalize(st);
+    return n;
+}
+
+static int PagedLoaderStart(PagedLoader *pl, Catalog *cat)
+{
+    memset(pl, 0, sizeof(*pl));
+    if (cat->kind != CATALOG_SQLITE)
+        return 0;
+
+    sqlite3_stmt *st = NULL;
+    if (sqlite3_prepare_v2(cat->db, "SELECT max(orbit_radius) FROM planets", -1, &st, NULL) == SQLITE_OK &&
+        sqlite3_step(st) == SQLITE_ROW)
+        pl->maxOrbit = (float)sqlite3_column_double(st, 0);
+    sqlite3_finalize(st);
+
+    pl->path = cat->path;
+    pl->lock = SDL_CreateMutex();
+    pl->wake = SDL_CreateCondition();
+    if (!pl->lock || !pl->wake)
+        return 0;
+    pl->thread = SDL_CreateThread(PagerThread, "catalog-pager", pl);
+    if (!pl->thread)
+    {
+        fprintf(stderr, "Failed to start paged loader: %s\n", SDL_GetError());
+        return 0;
+    }
+    pl->running = true;
+    printf("Streaming planets from '%s' (max orbit %.1f)\n", cat->path, pl->maxOrbit);
+    return 1;
+}
+
+static void PagedLoaderEvict(PagedLoader *pl, BodyStore *store, int band)
+{
+    CatalogPage *page = &pl->pages[band];
+    for (int i = 0; i < page->count; i++)
+        BodyStoreRemove(store, page->handles[i]);
+    pl->residentBodies -= page->count;
+    free(page->handles);
+    page->handles = NULL;
+    page->count = 0;
+    page->resident = false;
+}
+
+static void PagedLoaderStop(PagedLoader *pl, BodyStore *store)
+{
+    if (pl->thread)
+    {
+        SDL_LockMutex(pl->lock);
+        pl->quit = true;
+        SDL_SignalCondition(pl->wake);
+        SDL_UnlockMutex(pl->lock);
+        SDL_WaitThread(pl->thread, NULL);
+    }
+    while (pl->results)
+    {
+        PageResult *next = pl->results->next;
+        free(pl->results->bodies);
+        free(pl->results);
+        pl->results = next;
+    }
+    for (int b = 0; b < PAGER_MAX_BANDS; b++)
+        if (pl->pages[b].resident)
+            PagedLoaderEvict(pl, store, b);
+    SDL_DestroyCondition(pl->wake);
+    SDL_DestroyMutex(pl->lock);
+    memset(pl, 0, sizeof(*pl));
+}
+
+// forces the band holding orbitRadius to be fetched again, e.g. after an insert
+static void PagedLoaderInvalidateOrbit(PagedLoader *pl, float orbitRadius)
+{
+    pl->pages[PagerBandForOrbit(orbitRadius)].lod = INT_MIN;
+}
+
+static int PagerLodForBand(int band, float fov, float camDist)
+{
+    float nearDepth = camDist - PagerBandUpper(band);
+    if (nearDepth < 1.0f)
+        nearDepth = 1.0f;
+    float minRadius = PAGER_MIN_PIXELS * nearDepth / fov;
+    int lod = (int)floorf(log2f(minRadius));
+    if (lod < -16)
+        lod = -16;
+    if (lod > 16)
+        lod = 16;
+    return lod;
+}
+
+// returns true when the resident set changed
+static bool PagedLoaderUpdate(PagedLoader *pl, BodyStore *store,
+                              float fov, float camDist, float sinPitch,
+                              float sunX, float sunY, int winW, int winH)
+{
+    bool changed = false;
+    Uint64 now = ++pl->ticks;
+
+    SDL_LockMutex(pl->lock);
+    PageResult *results = pl->results;
+    pl->results = NULL;
+    SDL_UnlockMutex(pl->lock);
+
+    while (results)
+    {
+        PageResult *res = results;
+        results = res->next;
+        CatalogPage *page = &pl->pages[res->band];
+        if (page->resident)
+            PagedLoaderEvict(pl, store, res->band);
+        page->handles = (BodyHandle *)malloc(sizeof(BodyHandle) * (res->count > 0 ? res->count : 1));
+        if (page->handles)
+        {
+            for (int i = 0; i < res->count; i++)
+            {
+                Planet *p = &res->bodies[i];
+                p->angle = fmodf(p->angularSpeed * (float)now, 6.283185f);
+                page->handles[page->count] = BodyStoreAdd(store, p);
+                if (page->handles[page->count].generation != 0)
+                    page->count++;
+            }
+            page->resident = true;
+            page->lod = res->lod;
+            page->lastUsed = now;
+            pl->residentBodies += page->count;
+        }
+        SDL_LockMutex(pl->lock);
+        page->pending = false;
+        SDL_UnlockMutex(pl->lock);
+        free(res->bodies);
+        free(res);
+        changed = true;
+    }
+
+    // orbit range whose ellipse can touch the window
+    float x0 = sunX, y0 = sunY;
+    float nx = x0 < 0 ? 0 : (x0 > winW ? (float)winW : x0);
+    float ny = y0 < 0 ? 0 : (y0 > winH ? (float)winH : y0);
+    float dmin = sqrtf((x0 - nx) * (x0 - nx) + (y0 - ny) * (y0 - ny));
+    float fx = fmaxf(fabsf(x0), fabsf(winW - x0));
+    float fy = fmaxf(fabsf(y0), fabsf(winH - y0));
+    float dmax = sqrtf(fx * fx + fy * fy);
+    float rLo = dmin * camDist / (fov + dmin);
+    float denom = fov * fabsf(sinPitch) - dmax;
+    float rHi = denom > 0.0f ? dmax * camDist / denom : pl->maxOrbit;
+    if (rHi > pl->maxOrbit)
+        rHi = pl->maxOrbit;
+
+    if (rLo <= rHi)
+    {
+        int bandLo = PagerBandForOrbit(rLo);
+        int bandHi = PagerBandForOrbit(rHi);
+        SDL_LockMutex(pl->lock);
+        for (int b = bandLo; b <= bandHi; b++)
+        {
+            CatalogPage *page = &pl->pages[b];
+            page->lastUsed = now;
+            int lod = PagerLodForBand(b, fov, camDist);
+            if (page->pending || (page->resident && page->lod == lod))
+                continue;
+            if (pl->queueCount == PAGER_QUEUE_SIZE)
+                break;
+            int slot = (pl->queueHead + pl->queueCount) % PAGER_QUEUE_SIZE;
+            pl->queueBand[slot] = b;
+            pl->queueLod[slot] = lod;
+            pl->queueCount++;
+            page->pending = true;
+        }
+        SDL_SignalCondition(pl->wake);
+        SDL_UnlockMutex(pl->lock);
+    }
+
+    // LRU eviction, never touching bands that are on screen this frame
+    while (pl->residentBodies > PAGER_BODY_BUDGET)
+    {
+        int victim = -1;
+        for (int b = 0; b < PAGER_MAX_BANDS; b++)
+        {
+            CatalogPage *page = &pl->pages[b];
+            if (page->resident && page->lastUsed < now &&
+                (victim < 0 || page->lastUsed < pl->pages[victim].lastUsed))
+                victim = b;
+        }
+        if (victim < 0)
+            break;
+        PagedLoaderEvict(pl, store, victim);
+        changed = true;
+    }
+    return changed;
+}
+
+static void PagedLoaderInvalidateAll(PagedLoader *pl)
+{
+    for (int b = 0; b < PAGER_MAX_BANDS; b++)
+        pl->pages[b].lod = INT_MIN;
+}
+
+#define WATCH_POLL_MS 250
+#define WATCH_DEBOUNCE_MS 100
+
+// what the watcher remembers about each live body; 48 bytes instead of a Planet
+typedef struct
+{
+    Uint64 nameHash;
+    sqlite3_int64 catalogId;
+    int occurrence; // how many earlier rows share this name
+    float orbitRadius;
+    float angularSpeed;
+    float radius;
+    Uint8 r, g, b;
+    BodyHandle handle;
+} CatalogSnapshotRow;
+
+// arrays grow with the number of changes, not with the catalog
+typedef struct
+{
+    int numUpdates, capUpdates;
+    BodyHandle *updateHandles;
+    Planet *updates;
+    int numRemovals, capRemovals;
+    BodyHandle *removals;
+    int numAdds, capAdds;
+    Planet *adds;
+    int *addRows;           // index of each add in the new snapshot
+    BodyHandle *addHandles; // filled in by the main thread
+} CatalogChangeSet;
+
+typedef struct
+{
+    bool add;
+    Planet body;
+    BodyHandle handle;
+} CatalogEditNote;
+
+typedef struct
+{
+    CatalogKind kind;
+    const char *path;
+    const char *journalPath;
+    bool pagedOnly;
+    SDL_Thread *thread;
+    SDL_Mutex *lock;
+    SDL_Condition *applied;
+    bool quit;
+    bool pagesStale;
+    CatalogChangeSet *pending;
+    CatalogEditNote *notes; // in-program edits the snapshot has not seen yet
+    int numNotes;
+    int capNotes;
+    CatalogSnapshotRow *snapshot; // owned by the watcher thread once started
+    int snapshotCount;
+} CatalogWatcher;
+
+static Uint64 SnapshotRowKey(const CatalogWatcher *w, const CatalogSnapshotRow *row)
+{
+    if (w->kind == CATALOG_SQLITE)
+        return MixKey((Uint64)row->catalogId);
+    return MixKey(row->nameHash + (Uint64)row->occurrence * 0x9E3779B97F4A7C15ull);
+}
+
+static bool SnapshotRowSameKey(const CatalogWatcher *w, const CatalogSnapshotRow *a,
+                               const CatalogSnapshotRow *b)
+{
+    if (w->kind == CATALOG_SQLITE)
+        return a->catalogId == b->catalogId;
+    return a->nameHash == b->nameHash && a->occurrence == b->occurrence;
+}
+
+static bool SnapshotRowSameData(const CatalogSnapshotRow *a, const CatalogSnapshotRow *b)
+{
+    return a->nameHash == b->nameHash && a->orbitRadius == b->orbitRadius &&
+           a->angularSpeed == b->angularSpeed && a->radius == b->radius &&
+           a->r == b->r && a->g == b->g && a->b == b->b;
+}
+
+// fills rows from bodies, numbering repeated names in order of appearance
+static bool BuildSnapshotRows(const Planet *bodies, int n, CatalogSnapshotRow *rows)
+{
+    int size = HashTableSize(n);
+    int *firstRow = (int *)malloc(sizeof(int) * size);
+    int *counts = (int *)calloc(n > 0 ? n : 1, sizeof(int));
+    if (!firstRow || !counts)
+    {
+        free(firstRow);
+        free(counts);
+        return false;
+    }
+    memset(firstRow, 0xff, sizeof(int) * size);
+    for (int i = 0; i < n; i++)
+    {
+        const Planet *p = &bodies[i];
+        CatalogSnapshotRow *row = &rows[i];
+        memset(row, 0, sizeof(*row));
+        row->nameHash = HashName(p->name);
+        row->catalogId = p->catalogId;
+        row->orbitRadius = p->orbitRadius;
+        row->angularSpeed = p->angularSpeed;
+        row->radius = p->circle.radius;
+        row->r = p->circle.r;
+        row->g = p->circle.g;
+        row->b = p->circle.b;
+
+        int slot = (int)(MixKey(row->nameHash) & (Uint64)(size - 1));
+        while (firstRow[slot] >= 0 && rows[firstRow[slot]].nameHash != row->nameHash)
+            slot = (slot + 1) & (size - 1);
+        if (firstRow[slot] < 0)
+            firstRow[slot] = i;
+        row->occurrence = counts[firstRow[slot]]++;
+    }
+    free(firstRow);
+    free(counts);
+    return true;
+}
+
+static void FreeCatalogChangeSet(CatalogChangeSet *cs)
+{
+    if (!cs)
+        return;
+    free(cs->updateHandles);
+    free(cs->updates);
+    free(cs->removals);
+    free(cs->adds);
+    free(cs->addRows);
+    free(cs->addHandles);
+    free(cs);
+}
+
+// diffs fresh against the snapshot; rows receives the new snapshot, with the
+// handles of added rows left for the caller to fill in from addHandles
+static CatalogChangeSet *DiffCatalogSnapshot(const CatalogWatcher *w, const BodyStore *fresh,
+                                             CatalogSnapshotRow *rows)
+{
+    int oldCount = w->snapshotCount;
+    int n = fresh->count;
+    int size = HashTableSize(oldCount);
+    int *table = (int *)malloc(sizeof(int) * size);
+    bool *matched = (bool *)calloc(oldCount > 0 ? oldCount : 1, sizeof(bool));
+    CatalogChangeSet *cs = (CatalogChangeSet *)calloc(1, sizeof(CatalogChangeSet));
+    bool ok = table && matched && cs && BuildSnapshotRows(fresh->bodies, n, rows);
+
+    if (ok)
+    {
+        memset(table, 0xff, sizeof(int) * size);
+        for (int i = 0; i < oldCount; i++)
+        {
+            int slot = (int)(SnapshotRowKey(w, &w->snapshot[i]) & (Uint64)(size - 1));
+            while (table[slot] >= 0)
+                slot = (slot + 1) & (size - 1);
+            table[slot] = i;
+        }
+    }
+
+    for (int j = 0; ok && j < n; j++)
+    {
+        CatalogSnapshotRow *row = &rows[j];
+        int slot = (int)(SnapshotRowKey(w, row) & (Uint64)(size - 1));
+        int found = -1;
+        for (; table[slot] >= 0; slot = (slot + 1) & (size - 1))
+        {
+            int i = table[slot];
+            if (!matched[i] && SnapshotRowSameKey(w, &w->snapshot[i], row))
+            {
+                found = i;
+                break;
+            }
+        }
+        if (found >= 0)
+        {
+            matched[found] = true;
+            row->handle = w->snapshot[found].handle;
+            if (SnapshotRowSameData(&w->snapshot[found], row))
+                continue;
+            int cap = cs->capUpdates;
+            ok = GrowArray((void **)&cs->updateHandles, &cap, cs->numUpdates, sizeof(BodyHandle)) &&
+                 GrowArray((void **)&cs->updates, &cs->capUpdates, cs->numUpdates, sizeof(Planet));
+            if (ok)
+            {
+                cs->updateHandles[cs->numUpdates] = row->handle;
+                cs->updates[cs->numUpdates++] = fresh->bodies[j];
+            }
+        }
+        else
+        {
+            int cap = cs->capAdds, cap2 = cs->capAdds;
+            ok = GrowArray((void **)&cs->addRows, &cap, cs->numAdds, sizeof(int)) &&
+                 GrowArray((void **)&cs->addHandles, &cap2, cs->numAdds, sizeof(BodyHandle)) &&
+                 GrowArray((void **)&cs->adds, &cs->capAdds, cs->numAdds, sizeof(Planet));
+            if (ok)
+            {
+                cs->addRows[cs->numAdds] = j;
+                cs->addHandles[cs->numAdds] = row->handle;
+                cs->adds[cs->numAdds++] = fresh->bodies[j];
+            }
+        }
+    }
+    for (int i = 0; ok && i < oldCount; i++)
+    {
+        if (matched[i])
+            continue;
+        ok = GrowArray((void **)&cs->removals, &cs->capRemovals, cs->numRemovals, sizeof(BodyHandle));
+        if (ok)
+            cs->removals[cs->numRemovals++] = w->snapshot[i].handle;
+    }
+
+    free(table);
+    free(matched);
+    if (!ok)
+    {
+        FreeCatalogChangeSet(cs);
+        return NULL;
+    }
+    return cs;
+}
+
+// folds in-program edits into the snapshot so they are not replayed as changes
+static void ApplyCatalogEditNotes(CatalogWatcher *w)
+{
+    SDL_LockMutex(w->lock);
+    CatalogEditNote *notes = w->notes;
+    int numNotes = w->numNotes;
+    w->notes = NULL;
+    w->numNotes = w->capNotes = 0;
+    SDL_UnlockMutex(w->lock);
+
+    for (int k = 0; k < numNotes; k++)
+    {
+        CatalogEditNote *note = &notes[k];
+        if (note->add)
+        {
+            CatalogSnapshotRow *tmp = (CatalogSnapshotRow *)realloc(
+                w->snapshot, sizeof(CatalogSnapshotRow) * (w->snapshotCount + 1));
+            if (!tmp)
+                continue;
+            w->snapshot = tmp;
+            CatalogSnapshotRow *row = &w->snapshot[w->snapshotCount];
+            BuildSnapshotRows(&note->body, 1, row);
+            for (int i = 0; i < w->snapshotCount; i++)
+                if (w->snapshot[i].nameHash == row->nameHash)
+                    row->occurrence++;
+            row->handle = note->handle;
+            w->snapshotCount++;
+            continue;
+        }
+        for (int i = 0; i < w->snapshotCount; i++)
+        {
+            if (!BodyHandleEquals(w->snapshot[i].handle, note->handle))
+                continue;
+            CatalogSnapshotRow removed = w->snapshot[i];
+            memmove(&w->snapshot[i], &w->snapshot[i + 1],
+                    sizeof(CatalogSnapshotRow) * (w->snapshotCount - i - 1));
+            w->snapshotCount--;
+            for (int j = 0; j < w->snapshotCount; j++)
+                if (w->snapshot[j].nameHash == removed.nameHash &&
+                    w->snapshot[j].occurrence > removed.occurrence)
+                    w->snapshot[j].occurrence--;
+            break;
+        }
+    }
+    free(notes);
+}
+
+static int CatalogWatcherThread(void *data)
+{
+    CatalogWatcher *w = (CatalogWatcher *)data;
+    TRACE_THREAD("catalog-watch");
+    Catalog own;
+    memset(&own, 0, sizeof(own));
+    sqlite3_int64 lastVersion = -1;
+    SDL_PathInfo lastInfo;
+    memset(&lastInfo, 0, sizeof(lastInfo));
+#ifdef __linux__
+    int fd = -1;
+    char dirBuf[1024], baseBuf[1024];
+    const char *base = NULL;
+#endif
+
+    if (w->kind == CATALOG_SQLITE)
+    {
+        if (!CatalogOpen(&own, w->path))
+            return 1;
+    }
+    else
+    {
+        SDL_GetPathInfo(w->path, &lastInfo);
+#ifdef __linux__
+        // watch the directory so editors that save via rename are caught too
+        SDL_strlcpy(dirBuf, w->path, sizeof(dirBuf));
+        SDL_strlcpy(baseBuf, w->path, sizeof(baseBuf));
+        base = basename(baseBuf);
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0 && inotify_add_watch(fd, dirname(dirBuf),
+                                         IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+    bool reload = false;
+    for (;;)
+    {
+        SDL_LockMutex(w->lock);
+        bool quit = w->quit;
+        SDL_UnlockMutex(w->lock);
+        if (quit)
+            break;
+
+        bool changed = reload;
+        reload = false;
+        if (w->kind == CATALOG_SQLITE)
+        {
+            SDL_Delay(WATCH_POLL_MS);
+            sqlite3_stmt *st = NULL;
+            if (sqlite3_prepare_v2(own.db, "PRAGMA data_version", -1, &st, NULL) == SQLITE_OK &&
+                sqlite3_step(st) == SQLITE_ROW)
+            {
+                sqlite3_int64 v = sqlite3_column_int64(st, 0);
+                changed = changed || (lastVersion >= 0 && v != lastVersion);
+                lastVersion = v;
+            }
+            sqlite3_finalize(st);
+        }
+#ifdef __linux__
+        else if (fd >= 0)
+        {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int timeout = WATCH_POLL_MS;
+            while (poll(&pfd, 1, timeout) > 0)
+            {
+                char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+                ssize_t len;
+                while ((len = read(fd, buf, sizeof(buf))) > 0)
+                {
+                    for (char *p = buf; p < buf + len;)
+                    {
+                        struct inotify_event *ev = (struct inotify_event *)p;
+                        if (ev->len > 0 && strcmp(ev->name, base) == 0)
+                            changed = true;
+                        p += sizeof(struct inotify_event) + ev->len;
+                    }
+                }
+                if (!changed)
+                    break;
+                // keep draining until the writer has been quiet for a moment
+                timeout = WATCH_DEBOUNCE_MS;
+            }
+        }
+#endif
+        else
+        {
+            SDL_Delay(WATCH_POLL_MS);
+            SDL_PathInfo info;
+            if (SDL_GetPathInfo(w->path, &info) &&
+                (info.modify_time != lastInfo.modify_time || info.size != lastInfo.size))
+            {
+                lastInfo = info;
+                SDL_Delay(WATCH_DEBOUNCE_MS);
+                changed = true;
+            }
+        }
+        if (!changed)
+            continue;
+
+        if (w->pagedOnly)
+        {
+            SDL_LockMutex(w->lock);
+            w->pagesStale = true;
+            SDL_UnlockMutex(w->lock);
+            continue;
+        }
+
+        // edits noted so far are already on disk, so the load below sees them
+        ApplyCatalogEditNotes(w);
+
+        TRACE_BEGIN(loadStart);
+        BodyStore fresh;
+        BodyStoreInit(&fresh);
+        int loaded;
+        if (w->kind == CATALOG_SQLITE)
+            loaded = CatalogLoad(&own, &fresh);
+        else if (w->kind == CATALOG_BINARY)
+            loaded = LoadPlanetsFromBinaryFile(w->path, &fresh);
+        else
+            loaded = LoadTextCatalog(w->path, w->journalPath, &fresh, NULL, NULL);
+        TRACE_END(loadStart, "reload catalog");
+        // a half-written or emptied file is not applied; the next event retries
+        if (!loaded)
+        {
+            BodyStoreFree(&fresh);
+            continue;
+        }
+        // an edit noted during the load may or may not be in it; load again
+        SDL_LockMutex(w->lock);
+        reload = (w->numNotes > 0);
+        SDL_UnlockMutex(w->lock);
+        if (reload)
+        {
+            BodyStoreFree(&fresh);
+            continue;
+        }
+
+        TRACE_BEGIN(diffStart);
+        int n = fresh.count;
+        CatalogSnapshotRow *rows = (CatalogSnapshotRow *)malloc(sizeof(CatalogSnapshotRow) * n);
+        CatalogChangeSet *cs = rows ? DiffCatalogSnapshot(w, &fresh, rows) : NULL;
+        BodyStoreFree(&fresh);
+        TRACE_END(diffStart, "diff catalog");
+        if (!cs)
+        {
+            free(rows);
+            continue;
+        }
+
+        if (cs->numAdds + cs->numUpdates + cs->numRemovals > 0)
+        {
+            SDL_LockMutex(w->lock);
+            w->pending = cs;
+            while (w->pending && !w->quit)
+                SDL_WaitCondition(w->applied, w->lock);
+            bool applied = (w->pending == NULL);
+            w->pending = NULL;
+            SDL_UnlockMutex(w->lock);
+            if (!applied)
+            {
+                free(rows);
+                FreeCatalogChangeSet(cs);
+                break;
+            }
+            for (int k = 0; k < cs->numAdds; k++)
+                rows[cs->addRows[k]].handle = cs->addHandles[k];
+        }
+        free(w->snapshot);
+        w->snapshot = rows;
+        w->snapshotCount = n;
+        FreeCatalogChangeSet(cs);
+    }
+
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+    CatalogClose(&own);
+    return 0;
+}
+
+static int CatalogWatcherStart(CatalogWatcher *w, const Catalog *cat, const BodyStore *store, bool pagedOnly)
+{
+    memset(w, 0, sizeof(*w));
+    w->kind = cat->kind;
+    w->path = cat->path;
+    w->journalPath = cat->journalPath;
+    w->pagedOnly = pagedOnly;
+    if (!pagedOnly)
+    {
+        w->snapshot = (CatalogSnapshotRow *)malloc(sizeof(CatalogSnapshotRow) * (store->count + 1));
+        if (!w->snapshot || !BuildSnapshotRows(store->bodies, store->count, w->snapshot))
+            return 0;
+        for (int i = 0; i < store->count; i++)
+            w->snapshot[i].handle = BodyStoreHandleAt(store, i);
+        w->snapshotCount = store->count;
+    }
+    w->lock = SDL_CreateMutex();
+    w->applied = SDL_CreateCondition();
+    if (!w->lock || !w->applied)
+        return 0;
+    w->thread = SDL_CreateThread(CatalogWatcherThread, "catalog-watch", w);
+    if (!w->thread)
+    {
+        fprintf(stderr, "Failed to start catalog watcher: %s\n", SDL_GetError());
+        return 0;
+    }
+    return 1;
+}
+
+static void CatalogWatcherStop(CatalogWatcher *w)
+{
+    if (w->thread)
+    {
+        SDL_LockMutex(w->lock);
+        w->quit = true;
+        SDL_BroadcastCondition(w->applied);
+        SDL_UnlockMutex(w->lock);
+        SDL_WaitThread(w->thread, NULL);
+    }
+    SDL_DestroyCondition(w->applied);
+    SDL_DestroyMutex(w->lock);
+    free(w->notes);
+    free(w->snapshot);
+    memset(w, 0, sizeof(*w));
+}
+
+static void CatalogWatcherNote(CatalogWatcher *w, bool add, const Planet *body, BodyHandle h)
+{
+    if (!w->thread || w->pagedOnly)
+        return;
+    SDL_LockMutex(w->lock);
+    if (GrowArray((void **)&w->notes, &w->capNotes, w->numNotes, sizeof(CatalogEditNote)))
+    {
+        CatalogEditNote *note = &w->notes[w->numNotes++];
+        note->add = add;
+        if (body)
+            note->body = *body;
+        note->handle = h;
+    }
+    SDL_UnlockMutex(w->lock);
+}
+
+// applies whatever the watcher found since the last frame; true if bodies changed
+static bool CatalogWatcherPoll(CatalogWatcher *w, BodyStore *store, NameIndex *names,
+                               PagedLoader *pager, Uint64 ticks)
+{
+    if (!w->thread)
+        return false;
+    SDL_LockMutex(w->lock);
+    CatalogChangeSet *cs = w->pending;
+    bool pagesStale = w->pagesStale;
+    w->pagesStale = false;
+    SDL_UnlockMutex(w->lock);
+
+    if (pagesStale && pager->running)
+        PagedLoaderInvalidateAll(pager);
+    if (!cs)
+        return false;
+
+    // unchanged bodies are untouched and updated ones keep their phase
+    for (int i = 0; i < cs->numUpdates; i++)
+    {
+        Planet *p = BodyStoreGet(store, cs->updateHandles[i]);
+        if (!p)
+            continue;
+        const Planet *src = &cs->updates[i];
+        if (strcmp(p->name, src->name) != 0)
+            NameIndexRename(names, store, cs->updateHandles[i]);
+        memcpy(p->name, src->name, sizeof(p->name));
+        p->orbitRadius = src->orbitRadius;
+        p->angularSpeed = src->angularSpeed;
+        p->circle.radius = src->circle.radius;
+        p->circle.r = src->circle.r;
+        p->circle.g = src->circle.g;
+        p->circle.b = src->circle.b;
+        p->catalogId = src->catalogId;
+    }
+    for (int i = 0; i < cs->numRemovals; i++)
+        BodyStoreRemove(store, cs->removals[i]);
+    for (int i = 0; i < cs->numAdds; i++)
+    {
+        Planet *p = &cs->adds[i];
+        p->angle = fmodf(p->angularSpeed * (float)ticks, 6.283185f);
+        cs->addHandles[i] = BodyStoreAdd(store, p);
+        NameIndexAdd(names, cs->addHandles[i]);
+    }
+    printf("Catalog '%s' changed: %d added, %d updated, %d removed\n",
+           w->path, cs->numAdds, cs->numUpdates, cs->numRemovals);
+
+    SDL_LockMutex(w->lock);
+    w->pending = NULL;
+    SDL_SignalCondition(w->applied);
+    SDL_UnlockMutex(w->lock);
+    return true;
+}
+
+// --convert: loads any catalog kind and writes it as a binary catalog
+static int ConvertCatalog(const char *inPath, const char *outPath)
+{
+    if (!PathHasExtension(outPath, ".bin"))
+    {
+        fprintf(stderr, "Conversion target '%s' must be a .bin file.\n", outPath);
+        return 0;
+    }
+    Catalog cat;
+    BodyStore store;
+    BodyStoreInit(&store);
+    int ok = CatalogOpen(&cat, inPath) && CatalogLoad(&cat, &store) &&
+             SavePlanetsToBinaryFile(outPath, &store);
+    if (ok)
+        printf("Wrote %d planets to '%s'\n", store.count, outPath);
+    CatalogClose(&cat);
+    BodyStoreFree(&store);
+    return ok;
+}
+
+static bool PointInRect(float x, float y, const SDL_FRect *rect)
+{
+    return (x >= rect->x && x <= rect->x + rect->w &&
+            y >= rect->y && y <= rect->y + rect->h);
+}
+
+// Screen-space buckets over everything drawn in a frame. Each disc is listed in
+// every cell it touches, so a point query only tests the discs of one cell;
+// discs covering too many cells go on a short overflow list instead. Cells
+// shrink as the screen fills up, down to the size of the smallest target.
+#define PICK_MIN_RADIUS 4.0f // points and tiny discs still get a clickable area
+#define PICK_ITEMS_PER_CELL 16.0f
+#define PICK_MIN_CELL (2.0f * PICK_MIN_RADIUS)
+#define PICK_MAX_CELL 128.0f
+#define PICK_MAX_ITEM_CELLS 64
+#define PICK_HOVER_DISTANCE 12.0f
+
+typedef enum
+{
+    PICK_NONE = 0,
+    PICK_PLANET,
+    PICK_MOON,
+    PICK_ASTEROID
+} PickKind;
+
+typedef struct
+{
+    PickKind kind;
+    int index;         // moon or asteroid index
+    BodyHandle planet; // for PICK_PLANET
+} PickHit;
+
+typedef struct
+{
+    float x, y, radius, depth;
+    PickHit hit;
+} PickItem;
+
+typedef struct
+{
+    PickItem *items;
+    int count;
+    int capacity;
+    int *cellStart; // cols * rows + 1 offsets into cellItems
+    int *cellItems; // item indices grouped by cell
+    int cellCapacity;
+    int refCapacity;
+    int *overflow;
+    int numOverflow;
+    int cols, rows;
+    float cellSize;
+    float width, height;
+} PickGrid;
+
+static void PickGridBegin(PickGrid *g, int winW, int winH)
+{
+    g->count = 0;
+    g->width = (float)winW;
+    g->height = (float)winH;
+}
+
+static void PickGridAdd(PickGrid *g, float x, float y, float radius, float depth, PickHit hit)
+{
+    if (radius < PICK_MIN_RADIUS)
+        radius = PICK_MIN_RADIUS;
+    if (x + radius < 0.0f || y + radius < 0.0f || x - radius > g->width || y - radius > g->height)
+        return;
+    if (g->count == g->capacity &&
+        !GrowArray((void **)&g->items, &g->capacity, g->count, sizeof(PickItem)))
+        return;
+    PickItem *it = &g->items[g->count++];
+    it->x = x;
+    it->y = y;
+    it->radius = radius;
+    it->depth = depth;
+    it->hit = hit;
+}
+
+static void PickItemCells(const PickGrid *g, const PickItem *it, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = SDL_clamp((int)((it->x - it->radius) / g->cellSize), 0, g->cols - 1);
+    *y0 = SDL_clamp((int)((it->y - it->radius) / g->cellSize), 0, g->rows - 1);
+    *x1 = SDL_clamp((int)((it->x + it->radius) / g->cellSize), 0, g->cols - 1);
+    *y1 = SDL_clamp((int)((it->y + it->radius) / g->cellSize), 0, g->rows - 1);
+}
+
+// counting sort of the items into their cells
+static bool PickGridBuild(PickGrid *g)
+{
+    float cellSize = sqrtf(g->width * g->height * PICK_ITEMS_PER_CELL / (float)(g->count + 1));
+    g->cellSize = SDL_clamp(cellSize, PICK_MIN_CELL, PICK_MAX_CELL);
+    g->cols = (int)(g->width / g->cellSize) + 1;
+    g->rows = (int)(g->height / g->cellSize) + 1;
+    int numCells = g->cols * g->rows;
+    if (numCells + 1 > g->cellCapacity)
+    {
+        int *cellStart = (int *)realloc(g->cellStart, sizeof(int) * (numCells + 1));
+        if (!cellStart)
+        {
+            g->cols = g->rows = 0;
+            return false;
+        }
+        g->cellStart = cellStart;
+        g->cellCapacity = numCells + 1;
+    }
+    memset(g->cellStart, 0, sizeof(int) * (numCells + 1));
+    g->numOverflow = 0;
+
+    int refs = 0;
+    int overflowCap = 0;
+    for (int i = 0; i < g->count; i++)
+    {
+        int x0, y0, x1, y1;
+        PickItemCells(g, &g->items[i], &x0, &y0, &x1, &y1);
+        if ((x1 - x0 + 1) * (y1 - y0 + 1) > PICK_MAX_ITEM_CELLS)
+        {
+            overflowCap++;
+            continue;
+        }
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                g->cellStart[cy * g->cols + cx]++;
+        refs += (x1 - x0 + 1) * (y1 - y0 + 1);
+    }
+    if (refs + overflowCap > g->refCapacity)
+    {
+        int *cellItems = (int *)realloc(g->cellItems, sizeof(int) * (refs + overflowCap));
+        if (!cellItems)
+        {
+            g->cols = g->rows = 0;
+            return false;
+        }
+        g->cellItems = cellItems;
+        g->refCapacity = refs + overflowCap;
+    }
+    // overflow indices live after the cell lists
+    g->overflow = g->cellItems + refs;
+    for (int c = 1; c <= numCells; c++)
+        g->cellStart[c] += g->cellStart[c - 1];
+
+    // filling from the back leaves cellStart[c] at the start of cell c
+    for (int i = g->count - 1; i >= 0; i--)
+    {
+        int x0, y0, x1, y1;
+        PickItemCells(g, &g->items[i], &x0, &y0, &x1, &y1);
+        if ((x1 - x0 + 1) * (y1 - y0 + 1) > PICK_MAX_ITEM_CELLS)
+        {
+            g->overflow[g->numOverflow++] = i;
+            continue;
+        }
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                g->cellItems[--g->cellStart[cy * g->cols + cx]] = i;
+    }
+    return true;
+}
+
+static void PickTest(const PickGrid *g, int i, float x, float y, float maxDist,
+                     const PickItem **best, float *bestDist)
+{
+    const PickItem *it = &g->items[i];
+    float dx = x - it->x;
+    float dy = y - it->y;
+    float reach = it->radius + maxDist;
+    if (dx * dx + dy * dy > reach * reach)
+        return;
+    float dist = sqrtf(dx * dx + dy * dy) - it->radius;
+    if (dist < 0.0f)
+        dist = 0.0f;
+    // then nearest the camera; later items are drawn on top, so they win ties
+    if (!*best || dist < *bestDist ||
+        (dist == *bestDist && (it->depth < (*best)->depth ||
+                               (it->depth == (*best)->depth && it > *best))))
+    {
+        *best = it;
+        *bestDist = dist;
+    }
+}
+
+// the disc whose edge is nearest (x, y), up to maxDist away; discs containing
+// the point are all at distance 0 and the one nearest the camera wins
+static PickHit PickGridNearest(const PickGrid *g, float x, float y, float maxDist)
+{
+    PickHit none = {PICK_NONE, 0, {0, 0}};
+    if (g->cols == 0 || x < -maxDist || y < -maxDist ||
+        x > g->width + maxDist || y > g->height + maxDist)
+        return none;
+    const PickItem *best = NULL;
+    float bestDist = 0.0f;
+    int x0 = SDL_clamp((int)((x - maxDist) / g->cellSize), 0, g->cols - 1);
+    int y0 = SDL_clamp((int)((y - maxDist) / g->cellSize), 0, g->rows - 1);
+    int x1 = SDL_clamp((int)((x + maxDist) / g->cellSize), 0, g->cols - 1);
+    int y1 = SDL_clamp((int)((y + maxDist) / g->cellSize), 0, g->rows - 1);
+    for (int cy = y0; cy <= y1; cy++)
+    {
+        for (int cx = x0; cx <= x1; cx++)
+        {
+            int c = cy * g->cols + cx;
+            for (int k = g->cellStart[c]; k < g->cellStart[c + 1]; k++)
+                PickTest(g, g->cellItems[k], x, y, maxDist, &best, &bestDist);
+        }
+    }
+    for (int k = 0; k < g->numOverflow; k++)
+        PickTest(g, g->overflow[k], x, y, maxDist, &best, &bestDist);
+    return best ? best->hit : none;
+}
+
+// the disc under (x, y) that is nearest the camera
+static PickHit PickGridQuery(const PickGrid *g, float x, float y)
+{
+    return PickGridNearest(g, x, y, 0.0f);
+}
+
+static bool PickHitEquals(PickHit a, PickHit b)
+{
+    if (a.kind != b.kind)
+        return false;
+    return a.kind == PICK_PLANET ? BodyHandleEquals(a.planet, b.planet) : a.index == b.index;
+}
+
+static void PickGridFree(PickGrid *g)
+{
+    free(g->items);
+    free(g->cellStart);
+    free(g->cellItems);
+    memset(g, 0, sizeof(*g));
+}
+
+// a scrolling list that only touches the rows inside area; row i occupies
+// [area.y + i * rowH - scroll, + rowH)
+typedef struct
+{
+    SDL_FRect area;
+    float rowH;
+    double scroll; // a float runs out of precision a few million rows down
+    int count;
+} ListView;
+
+#define LIST_SCROLLBAR_W 12.0f
+
+static double ListViewMaxScroll(const ListView *lv)
+{
+    double content = (double)lv->count * lv->rowH - lv->area.h;
+    return content > 0.0 ? content : 0.0;
+}
+
+static void ListViewScrollTo(ListView *lv, double scroll)
+{
+    double maxScroll = ListViewMaxScroll(lv);
+    lv->scroll = scroll < 0.0 ? 0.0 : (scroll > maxScroll ? maxScroll : scroll);
+}
+
+static void ListViewSetCount(ListView *lv, int count)
+{
+    lv->count = count;
+    ListViewScrollTo(lv, lv->scroll);
+}
+
+static int ListViewFirstVisible(const ListView *lv)
+{
+    return (int)(lv->scroll / lv->rowH);
+}
+
+// one past the last row with any part inside area
+static int ListViewEndVisible(const ListView *lv)
+{
+    int end = (int)ceil((lv->scroll + lv->area.h) / lv->rowH);
+    return end < lv->count ? end : lv->count;
+}
+
+static SDL_FRect ListViewRowRect(const ListView *lv, int i)
+{
+    SDL_FRect r = {
+        lv->area.x,
+        lv->area.y + (float)((double)i * lv->rowH - lv->scroll),
+        lv->area.w,
+        lv->rowH - 4.0f};
+    return r;
+}
+
+// row under (x, y), or -1; the 4px gap between rows is not part of a row
+static int ListViewRowAt(const ListView *lv, float x, float y)
+{
+    if (!PointInRect(x, y, &lv->area))
+        return -1;
+    double offset = y - lv->area.y + lv->scroll;
+    int i = (int)(offset / lv->rowH);
+    if (i >= lv->count || offset - (double)i * lv->rowH > lv->rowH - 4.0f)
+        return -1;
+    return i;
+}
+
+static SDL_FRect ListViewScrollbarTrack(const ListView *lv)
+{
+    SDL_FRect r = {
+        lv->area.x + lv->area.w + 4.0f,
+        lv->area.y,
+        LIST_SCROLLBAR_W,
+        lv->area.h};
+    return r;
+}
+
+static SDL_FRect ListViewScrollbarThumb(const ListView *lv)
+{
+    SDL_FRect track = ListViewScrollbarTrack(lv);
+    double content = (double)lv->count * lv->rowH;
+    double maxScroll = ListViewMaxScroll(lv);
+    float h = content > track.h ? (float)(track.h * track.h / content) : track.h;
+    if (h < 20.0f)
+        h = 20.0f;
+    SDL_FRect r = {
+        track.x,
+        track.y + (maxScroll > 0.0 ? (float)((track.h - h) * lv->scroll / maxScroll) : 0.0f),
+        track.w,
+        h};
+    return r;
+}
+
+// drags the thumb so its centre follows y
+static void ListViewScrollToThumb(ListView *lv, float y)
+{
+    SDL_FRect track = ListViewScrollbarTrack(lv);
+    SDL_FRect thumb = ListViewScrollbarThumb(lv);
+    float range = track.h - thumb.h;
+    if (range <= 0.0f)
+        return;
+    float t = (y - track.y - thumb.h * 0.5f) / range;
+    ListViewScrollTo(lv, t * ListViewMaxScroll(lv));
+}
+
+// Every clickable rectangle of the UI, in drawing order. The layout is
+// recomputed only when the window size or the set of open panels changes, and
+// both the event handlers and the renderer read it from here.
+typedef enum
+{
+    WIDGET_NONE = -1,
+    WIDGET_ADD_BUTTON,
+    WIDGET_REMOVE_BUTTON,
+    WIDGET_PANEL,
+    WIDGET_FIELD, // FIELD_COUNT add panel fields
+    WIDGET_SAVE = WIDGET_FIELD + FIELD_COUNT,
+    WIDGET_CANCEL,
+    WIDGET_FILTER, // orbit min, orbit max and name search
+    WIDGET_GOTO = WIDGET_FILTER + 3,
+    WIDGET_SELECT,
+    WIDGET_LIST,
+    WIDGET_LIST_TRACK,
+    WIDGET_DELETE,
+    WIDGET_CLOSE,
+    WIDGET_CONFIRM,
+    WIDGET_YES,
+    WIDGET_NO,
+    WIDGET_COUNT
+} WidgetId;
+
+typedef struct
+{
+    SDL_FRect rects[WIDGET_COUNT];
+    bool visible[WIDGET_COUNT];
+    int winW, winH;
+    bool addOpen, removeOpen, confirmOpen;
+    Uint32 version; // 0 until the first layout
+    // last hit test, reused while neither the point nor the layout moves
+    float hitX, hitY;
+    Uint32 hitVersion;
+    WidgetId hit;
+} UiLayout;
+
+static void UiLayoutSet(UiLayout *ui, WidgetId id, float x, float y, float w, float h)
+{
+    SDL_FRect r = {x, y, w, h};
+    ui->rects[id] = r;
+    ui->visible[id] = true;
+}
+
+// returns true if the layout changed
+static bool UiLayoutUpdate(UiLayout *ui, int winW, int winH,
+                           bool addOpen, bool removeOpen, bool confirmOpen)
+{
+    if (ui->version != 0 && ui->winW == winW && ui->winH == winH && ui->addOpen == addOpen &&
+        ui->removeOpen == removeOpen && ui->confirmOpen == confirmOpen)
+        return false;
+    ui->winW = winW;
+    ui->winH = winH;
+    ui->addOpen = addOpen;
+    ui->removeOpen = removeOpen;
+    ui->confirmOpen = confirmOpen;
+    if (++ui->version == 0)
+        ui->version = 1;
+    memset(ui->visible, 0, sizeof(ui->visible));
+
+    UiLayoutSet(ui, WIDGET_ADD_BUTTON, 10.0f, 10.0f, 160.0f, 40.0f);
+    UiLayoutSet(ui, WIDGET_REMOVE_BUTTON, 180.0f, 10.0f, 180.0f, 40.0f);
+    if (!addOpen && !removeOpen)
+        return true;
+
+    UiLayoutSet(ui, WIDGET_PANEL, winW * 0.5f - 350.0f, winH * 0.5f - 220.0f, 700.0f, 440.0f);
+    SDL_FRect panel = ui->rects[WIDGET_PANEL];
+    if (addOpen)
+    {
+        for (int i = 0; i < FIELD_COUNT; i++)
+            UiLayoutSet(ui, (WidgetId)(WIDGET_FIELD + i),
+                        panel.x + 30.0f + 140.0f, panel.y + 60.0f + i * 40.0f, 300.0f, 28.0f);
+        UiLayoutSet(ui, WIDGET_SAVE, panel.x + 80.0f, panel.y + panel.h - 70.0f, 180.0f, 40.0f);
+        UiLayoutSet(ui, WIDGET_CANCEL, panel.x + panel.w - 260.0f, panel.y + panel.h - 70.0f, 180.0f, 40.0f);
+        return true;
+    }
+
+    UiLayoutSet(ui, WIDGET_FILTER, panel.x + 150.0f, panel.y + 55.0f, 120.0f, 28.0f);
+    UiLayoutSet(ui, (WidgetId)(WIDGET_FILTER + 1), panel.x + 330.0f, panel.y + 55.0f, 120.0f, 28.0f);
+    UiLayoutSet(ui, (WidgetId)(WIDGET_FILTER + 2), panel.x + 300.0f, panel.y + 12.0f, 240.0f, 28.0f);
+    UiLayoutSet(ui, WIDGET_GOTO, panel.x + 550.0f, panel.y + 11.0f, 120.0f, 30.0f);
+    UiLayoutSet(ui, WIDGET_SELECT, panel.x + 480.0f, panel.y + 54.0f, 180.0f, 30.0f);
+    UiLayoutSet(ui, WIDGET_LIST, panel.x + 30.0f, panel.y + 100.0f, panel.w - 76.0f, 256.0f);
+    ListView list = {ui->rects[WIDGET_LIST], 0.0f, 0.0, 0};
+    SDL_FRect track = ListViewScrollbarTrack(&list);
+    UiLayoutSet(ui, WIDGET_LIST_TRACK, track.x, track.y, track.w, track.h);
+    UiLayoutSet(ui, WIDGET_DELETE, panel.x + 40.0f, panel.y + panel.h - 60.0f, 280.0f, 35.0f);
+    UiLayoutSet(ui, WIDGET_CLOSE, panel.x + panel.w - 180.0f, panel.y + panel.h - 60.0f, 140.0f, 35.0f);
+    if (confirmOpen)
+    {
+        UiLayoutSet(ui, WIDGET_CONFIRM, panel.x + 50.0f, panel.y + panel.h - 150.0f, panel.w - 100.0f, 70.0f);
+        SDL_FRect box = ui->rects[WIDGET_CONFIRM];
+        UiLayoutSet(ui, WIDGET_YES, box.x + 40.0f, box.y + 30.0f, 180.0f, 30.0f);
+        UiLayoutSet(ui, WIDGET_NO, box.x + box.w - 220.0f, box.y + 30.0f, 180.0f, 30.0f);
+    }
+    return true;
+}
+
+// the topmost visible widget under (x, y)
+static WidgetId UiHitTest(UiLayout *ui, float x, float y)
+{
+    if (ui->hitVersion == ui->version && ui->hitX == x && ui->hitY == y)
+        return ui->hit;
+    WidgetId hit = WIDGET_NONE;
+    for (int i = WIDGET_COUNT - 1; i >= 0; i--)
+    {
+        if (ui->visible[i] && PointInRect(x, y, &ui->rects[i]))
+        {
+            hit = (WidgetId)i;
+            break;
+        }
+    }
+    ui->hitX = x;
+    ui->hitY = y;
+    ui->hitVersion = ui->version;
+    ui->hit = hit;
+    return hit;
+}
+
+static void AppendTextInput(TextField *tf, const char *text)
+{
+    int len = (int)strlen(tf->text);
+    for (const char *p = text; *p && len < tf->maxLen - 1; p++)
+    {
+        char ch = *p;
+        if (tf->numericOnly && !((ch >= '0' && ch <= '9') || ch == '.' || ch == '-'))
+            continue;
+        tf->text[len++] = ch;
+        tf->text[len] = '\0';
+    }
+}
+
+static void ClearBodyMarks(BodyStore *store)
+{
+    for (int i = 0; i < store->count; i++)
+        store->bodies[i].marked = false;
+}
+
+// the rows of the remove list: every body in store order, or the run of the
+// name index matching the search prefix
+typedef struct
+{
+    const NameIndex *names; // NULL when unfiltered
+    int first;
+    int count;
+} BodyRows;
+
+static BodyRows BodyRowsFor(NameIndex *names, const BodyStore *store, const char *search)
+{
+    BodyRows rows = {NULL, 0, store->count};
+    if (search[0] && NameIndexSync(names, store))
+    {
+        rows.names = names;
+        rows.count = NameIndexFindPrefix(names, store, search, &rows.first);
+    }
+    return rows;
+}
+
+// dense index of a row, or -1
+static int BodyRowIndex(const BodyRows *rows, const BodyStore *store, int row)
+{
+    if (row < 0 || row >= rows->count)
+        return -1;
+    if (!rows->names)
+        return row < store->count ? row : -1;
+    return BodyStoreIndexOf(store, rows->names->entries[rows->first + row].handle);
+}
+
+// marks rows a..b in either order; returns how many were newly marked
+static int MarkBodyRange(BodyStore *store, const BodyRows *rows, int a, int b)
+{
+    int lo = a < b ? a : b;
+    int hi = a < b ? b : a;
+    int added = 0;
+    for (int row = lo; row <= hi && row < rows->count; row++)
+    {
+        int i = BodyRowIndex(rows, store, row);
+        if (i < 0)
+            continue;
+        added += !store->bodies[i].marked;
+        store->bodies[i].marked = true;
+    }
+    return added;
+}
+
+// the remove panel's filter: marks exactly the listed bodies with an orbit
+// radius in [minOrbit, maxOrbit] and returns how many that is
+static int MarkBodiesInOrbitRange(BodyStore *store, const BodyRows *rows, float minOrbit, float maxOrbit)
+{
+    if (rows->names)
+        ClearBodyMarks(store);
+    int marked = 0;
+    for (int row = 0; row < rows->count; row++)
+    {
+        int i = BodyRowIndex(rows, store, row);
+        if (i < 0)
+            continue;
+        Planet *p = &store->bodies[i];
+        p->marked = p->orbitRadius >= minOrbit && p->orbitRadius <= maxOrbit;
+        marked += p->marked;
+    }
+    return marked;
+}
+
+static int CountMarkedBodies(const BodyStore *store)
+{
+    int marked = 0;
+    for (int i = 0; i < store->count; i++)
+        marked += store->bodies[i].marked;
+    return marked;
+}
+
+static int RemoveMarkedBodies(Catalog *cat, BodyStore *store, CatalogWatcher *w)
+{
+    BodyHandle *handles = (BodyHandle *)malloc(sizeof(BodyHandle) * (store->count + 1));
+    if (!handles)
+        return 0;
+    int n = 0;
+    for (int i = 0; i < store->count; i++)
+    {
+        if (store->bodies[i].marked)
+            handles[n++] = BodyStoreHandleAt(store, i);
+    }
+    int removed = CatalogRemoveMany(cat, store, handles, n);
+    for (int i = 0; i < n; i++)
+    {
+        if (!BodyStoreGet(store, handles[i]))
+            CatalogWatcherNote(w, false, NULL, handles[i]);
+    }
+    free(handles);
+    return removed;
+}
+
+// Benchmark scenarios for --bench. Each one builds a synthetic catalog from a
+// fixed seed and flies a scripted camera over it, so runs are comparable
+// across builds and machines.
+#define BENCH_WARMUP_FRAMES 30
+#define BENCH_FRAMES 300
+
+typedef struct
+{
+    const char *name;
+    int planets;
+    int asteroids;
+    int stars;
+    float zoom;
+    float yawStep;    // camera spin per frame, radians
+    float pitchSwing; // amplitude of the pitch oscillation, radians
+    float zoomSwing;  // amplitude of the zoom oscillation, as a fraction of zoom
+    unsigned int seed;
+} BenchScenario;
+
+// the first bodies get the real planet names so the moons find their parents
+static bool BenchPopulate(BodyStore *store, const BenchScenario *sc)
+{
+    static const char *const planetNames[] = {
+        "Mercury", "Venus", "Earth", "Mars", "Jupiter", "Saturn", "Uranus", "Neptune"};
+    srand(sc->seed);
+    if (!BodyStoreReserve(store, sc->planets))
+        return false;
+    for (int i = 0; i < sc->planets; i++)
+    {
+        char name[32];
+        if (i < 8)
+            snprintf(name, sizeof(name), "%s", planetNames[i]);
+        else
+            snprintf(name, sizeof(name), "BODY %d", i + 1);
+        float orbit = 60.0f + (float)rand() / RAND_MAX * 1200.0f;
+        float speed = 0.02f * powf(60.0f / orbit, 1.5f);
+        float radius = 2.0f + (float)(rand() % 8);
+        Planet p;
+        InitPlanet(&p, name, orbit, speed, radius, 80 + rand() % 176, 80 + rand() % 176, 80 + rand() % 176);
+        if (BodyStoreAdd(store, &p).generation == 0)
+            return false;
+    }
+    return true;
+}
+
+static void BenchCamera(const BenchScenario *sc, Uint64 frame, float *yaw, float *pitch, float *zoom)
+{
+    float t = (float)frame;
+    *yaw = 0.5f + sc->yawStep * t;
+    *pitch = 0.5f + sc->pitchSwing * sinf(t * 0.02f);
+    *zoom = SDL_clamp(sc->zoom * (1.0f + sc->zoomSwing * sinf(t * 0.01f)), 0.2f, 5.0f);
+}
+
+#ifdef SOLAR_PROFILE
+static const BenchScenario benchScenarios[] = {
+    {"static", 9, NUM_ASTEROIDS, NUM_STARS, 0.7f, 0.0f, 0.0f, 0.0f, 42},
+    {"orbit", 9, NUM_ASTEROIDS, NUM_STARS, 0.7f, 0.01f, 0.4f, 0.0f, 42},
+    {"zoom", 200, 1000, NUM_STARS, 0.7f, 0.002f, 0.0f, 0.6f, 42},
+    {"crowd", 2000, 5000, 2000, 0.7f, 0.005f, 0.3f, 0.0f, 42},
+    {"dense", 10000, 20000, 4000, 0.5f, 0.005f, 0.3f, 0.2f, 42}};
+
+static const BenchScenario *FindBenchScenario(const char *name)
+{
+    for (size_t i = 0; i < sizeof(benchScenarios) / sizeof(benchScenarios[0]); i++)
+    {
+        if (strcmp(benchScenarios[i].name, name) == 0)
+            return &benchScenarios[i];
+    }
+    fprintf(stderr, "Unknown benchmark scenario '%s'; try", name);
+    for (size_t i = 0; i < sizeof(benchScenarios) / sizeof(benchScenarios[0]); i++)
+        fprintf(stderr, " %s", benchScenarios[i].name);
+    fprintf(stderr, "\n");
+    return NULL;
+}
+
+static void PrintStatsJson(const char *name, StageStats st, bool last)
+{
+    printf("    \"%s\": {\"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f}%s\n",
+           name, st.min, st.mean, st.p50, st.p99, last ? "" : ",");
+}
+
+// renderer calls per frame, averaged over the run
+static void PrintCallsJson(const char *name, const FrameRecord *records, int n, int stage, bool last)
+{
+    double drawCalls = 0.0, primitives = 0.0, colorCalls = 0.0, stateChanges = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        const RenderCounts *c = &records[i].render[stage];
+        drawCalls += c->drawCalls;
+        primitives += c->primitives;
+        colorCalls += c->colorCalls;
+        stateChanges += c->stateChanges;
+    }
+    if (n > 0)
+    {
+        drawCalls /= n;
+        primitives /= n;
+        colorCalls /= n;
+        stateChanges /= n;
+    }
+    printf("    \"%s\": {\"draw_calls\": %.1f, \"primitives\": %.1f, \"color_calls\": %.1f, "
+           "\"state_changes\": %.1f}%s\n",
+           name, drawCalls, primitives, colorCalls, stateChanges, last ? "" : ",");
+}
+
+// hardware counter means per frame over the stages in stageMask
+static void PrintCountersJson(const char *name, const FrameRecord *records, int n, Uint32 stageMask,
+                              bool last)
+{
+    double sums[HW_COUNT] = {0};
+    for (int i = 0; i < n; i++)
+    {
+        for (int s = 0; s <= STAGE_COUNT; s++)
+        {
+            if (!(stageMask & (1u << s)))
+                continue;
+            for (int k = 0; k < HW_COUNT; k++)
+                sums[k] += (double)records[i].hw[s][k];
+        }
+    }
+    printf("    \"%s\": {", name);
+    for (int k = 0; k < HW_COUNT; k++)
+        printf("\"%s\": %.0f, ", hwCounterNames[k], n > 0 ? sums[k] / n : 0.0);
+    printf("\"ipc\": %.3f}%s\n", sums[HW_CYCLES] > 0.0 ? sums[HW_INSTRUCTIONS] / sums[HW_CYCLES] : 0.0,
+           last ? "" : ",");
+}
+
+// one JSON object on stdout; times are in milliseconds
+static void BenchReport(const BenchScenario *sc, int planets, int width, int height)
+{
+    static FrameRecord records[BENCH_FRAMES];
+    int n = ProfileCollect(records, BENCH_FRAMES);
+    Uint32 render = (1u << STAGE_STARS) | (1u << STAGE_ORBITS) | (1u << STAGE_ASTEROIDS) |
+                    (1u << STAGE_BODIES) | (1u << STAGE_UI) | (1u << STAGE_PRESENT);
+    printf("{\n");
+    printf("  \"scenario\": \"%s\",\n", sc->name);
+    printf("  \"seed\": %u,\n", sc->seed);
+    printf("  \"frames\": %d,\n", n);
+    printf("  \"width\": %d,\n", width);
+    printf("  \"height\": %d,\n", height);
+    printf("  \"planets\": %d,\n", planets);
+    printf("  \"asteroids\": %d,\n", sc->asteroids);
+    printf("  \"stars\": %d,\n", sc->stars);
+    printf("  \"unit\": \"ms\",\n");
+    printf("  \"summary\": {\n");
+    PrintStatsJson("update", ProfileStageStats(records, n, STAGE_UPDATE), false);
+    PrintStatsJson("projection", ProfileStageStats(records, n, STAGE_PROJECT), false);
+    PrintStatsJson("render", ProfileGroupStats(records, n, render), false);
+    PrintStatsJson("frame", ProfileStageStats(records, n, STAGE_COUNT), true);
+    printf("  },\n");
+    printf("  \"stages\": {\n");
+    for (int s = 0; s < STAGE_COUNT; s++)
+        PrintStatsJson(profileStageNames[s], ProfileStageStats(records, n, s), s == STAGE_COUNT - 1);
+    printf("  },\n");
+    printf("  \"calls\": {\n");
+    for (int s = 0; s <= STAGE_COUNT; s++)
+        PrintCallsJson(profileStageNames[s], records, n, s, s == STAGE_COUNT);
+    printf("  },\n");
+    if (profiler.hwFd[0] < 0)
+    {
+        printf("  \"counters\": null\n");
+        printf("}\n");
+        return;
+    }
+    printf("  \"counters\": {\n");
+    for (int s = 0; s < STAGE_COUNT; s++)
+        PrintCountersJson(profileStageNames[s], records, n, 1u << s, false);
+    PrintCountersJson("render", records, n, render, false);
+    PrintCountersJson("frame", records, n, 1u << STAGE_COUNT, true);
+    printf("  }\n");
+    printf("}\n");
+}
+#endif
+
+// bench.c includes this file for its static functions and brings its own main
+#ifndef SOLAR_NO_MAIN
+int main(int argc, char *argv[])
+{
+    if (argc == 4 && strcmp(argv[1], "--convert") == 0)
+        return ConvertCatalog(argv[2], argv[3]) ? 0 : 1;
+
+    // --live-panels keeps simulating and drawing the scene behind open panels,
+    // --trace <file> writes a Chrome trace, --bench <scenario> runs a
+    // benchmark and --perf-counters adds hardware counters to the profile;
+    // those three need a profiling build. --hitch-ms <ms> logs frames that
+    // take longer than that and --metrics <port|unix:path> serves Prometheus
+    // metrics
+    const char *catalogPath = "planets.txt";
+    const char *tracePath = NULL;
+    const char *benchName = NULL;
+    bool freezeBehindPanels = true;
+    bool perfCounters = false;
+    float hitchMs = 0.0f;
+    const char *metricsAddress = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--live-panels") == 0)
+            freezeBehindPanels = false;
+        else if (strcmp(argv[i], "--perf-counters") == 0)
+            perfCounters = true;
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+            metricsAddress = argv[++i];
+        else if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc)
+        {
+            hitchMs = strtof(argv[++i], NULL);
+            if (hitchMs <= 0.0f)
+            {
+                fprintf(stderr, "--hitch-ms needs a budget in milliseconds, got '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+            benchName = argv[++i];
+        else
+            catalogPath = argv[i];
+    }
+    const BenchScenario *bench = NULL;
+    if (benchName)
+    {
+#ifdef SOLAR_PROFILE
+        bench = FindBenchScenario(benchName);
+        if (!bench)
+            return 1;
+#else
+        fprintf(stderr, "Benchmarks need a build with -DSOLAR_PROFILE.\n");
+        return 1;
+#endif
+    }
+
+    if (!SDL_Init(bench ? SDL_INIT_EVENTS : SDL_INIT_VIDEO))
+    {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    // benchmarks draw into an offscreen surface with the software renderer,
+    // so they need no display and never wait for vsync
+    SDL_Window *window = NULL;
+    SDL_Surface *benchSurface = NULL;
+    SDL_Renderer *renderer = NULL;
+    if (bench)
+    {
+        benchSurface = SDL_CreateSurface(WIDTH, HEIGHT, SDL_PIXELFORMAT_XRGB8888);
+        if (benchSurface)
+            renderer = SDL_CreateSoftwareRenderer(benchSurface);
+    }
+    else
+    {
+        window = SDL_CreateWindow(
+            "3D-ish Solar System (Add/Remove + Stars)",
+            WIDTH, HEIGHT,
+            SDL_WINDOW_RESIZABLE);
+        if (!window)
+        {
+            fprintf(stderr, "SDL_CreateWindow failed: %s\n", SDL_GetError());
+            SDL_Quit();
+            return 1;
+        }
+        renderer = SDL_CreateRenderer(window, NULL);
+    }
+    if (!renderer)
+    {
+        fprintf(stderr, "SDL_CreateRenderer failed: %s\n", SDL_GetError());
+        SDL_DestroySurface(benchSurface);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    if (tracePath)
+    {
+#ifdef SOLAR_PROFILE
+        if (TraceStart(tracePath))
+            TraceThreadName("main");
+#else
+        fprintf(stderr, "Tracing needs a build with -DSOLAR_PROFILE; '%s' not written.\n", tracePath);
+#endif
+    }
+    if (perfCounters)
+    {
+#ifdef SOLAR_PROFILE
+        HwCountersStart();
+#else
+        fprintf(stderr, "Hardware counters need a build with -DSOLAR_PROFILE.\n");
+#endif
+    }
+    if (hitchMs > 0.0f)
+        HitchStart(hitchMs);
+    // before the catalog threads start, since they count their I/O
+    if (metricsAddress)
+        MetricsStart(metricsAddress);
+
+    Catalog catalog;
+    PagedLoader pager;
+    CatalogWatcher watcher;
+    BodyStore store;
+    NameIndex names;
+    BodyStoreInit(&store);
+    memset(&pager, 0, sizeof(pager));
+    memset(&watcher, 0, sizeof(watcher));
+    memset(&names, 0, sizeof(names));
+    memset(&catalog, 0, sizeof(catalog));
+    bool catalogOk = bench ? BenchPopulate(&store, bench) : CatalogOpen(&catalog, catalogPath);
+    if (bench)
+        catalogPath = bench->name;
+    else if (catalogOk && CatalogCountRows(&catalog) > PAGED_LOAD_THRESHOLD)
+        catalogOk = PagedLoaderStart(&pager, &catalog);
+    else if (catalogOk)
+    {
+        TRACE_BEGIN(loadStart);
+        catalogOk = CatalogLoad(&catalog, &store) && store.count > 0;
+        TRACE_END(loadStart, "load catalog");
+    }
+    // paged catalogs index whatever is resident, on first use
+    if (catalogOk && (pager.running || !NameIndexBuild(&names, &store)))
+        NameIndexInvalidate(&names);
+    if (catalogOk && !bench && !CatalogWatcherStart(&watcher, &catalog, &store, pager.running))
+        fprintf(stderr, "Catalog hot reload disabled for '%s'\n", catalogPath);
+    if (!catalogOk)
+    {
+        fprintf(stderr, "No planets loaded. Ensure '%s' exists.\n", catalogPath);
+        PagedLoaderStop(&pager, &store);
+        CatalogClose(&catalog);
+        MetricsStop();
+        TRACE_STOP();
+#ifdef SOLAR_PROFILE
+        HwCountersStop();
+#endif
+        BodyStoreFree(&store);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroySurface(benchSurface);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
+    const float BASE_FOV = 800.0f;
+    const float CAM_DIST = 1500.0f;
+    float zoom = 0.7f;
+    float camYaw = 0.5f;
+    float camPitch = 0.5f;
+    float camPanX = 0.0f;
+    float camPanY = 0.0f;
+    BodyHandle followPlanet = {0, 0}; // kept at the centre of the view by "go to"
+    const float ROTATE_SENS = 0.005f;
+    const float PAN_SENS = 1.0f;
+
+    int mouseLeft = 0, mouseRight = 0;
+    int lastX = 0, lastY = 0;
+
+    srand(bench ? bench->seed : 42);
+
+    struct Circle sun = {0, 0, 30, 255, 255, 0};
+    float sunScreenX = 0, sunScreenY = 0, sunDepth = 1, sunScreenRadius = 1;
+
+    float innerBelt = 170.0f;
+    float outerBelt = 230.0f;
+    // the asteroid and star arrays share one block, sized by the scenario
+    int running = 1;
+    int status = 0;
+    int numAsteroids = bench ? bench->asteroids : NUM_ASTEROIDS;
+    int numStars = bench ? bench->stars : NUM_STARS;
+    float *sceneArrays = (float *)malloc(sizeof(float) * (6 * numAsteroids + 2 * numStars) + numStars);
+    if (!sceneArrays)
+    {
+        fprintf(stderr, "Out of memory for %d asteroids and %d stars\n", numAsteroids, numStars);
+        running = 0;
+        status = 1;
+        numAsteroids = 0;
+        numStars = 0;
+    }
+    float *asteroid_radius = sceneArrays;
+    float *asteroid_angle = asteroid_radius + numAsteroids;
+    float *asteroid_speed = asteroid_angle + numAsteroids;
+
+    for (int i = 0; i < numAsteroids; i++)
+    {
+        asteroid_radius[i] = innerBelt + (float)rand() / RAND_MAX * (outerBelt - innerBelt);
+        asteroid_angle[i] = (float)rand() / RAND_MAX * 6.283185f;
+        asteroid_speed[i] = 0.01f + (float)rand() / RAND_MAX * 0.005f;
+    }
+
+    struct Moon moons[NUM_MOONS] = {
+        {0, 0, 3, 210, 210, 210, {0, 0}, "Earth", 18, 0, 0.08f},
+        {0, 0, 2, 200, 200, 200, {0, 0}, "Mars", 10, 1, 0.10f},
+        {0, 0, 2, 160, 160, 160, {0, 0}, "Mars", 15, 2, 0.07f},
+        {0, 0, 4, 255, 200, 180, {0, 0}, "Jupiter", 30, 0, 0.09f},
+        {0, 0, 3, 180, 220, 255, {0, 0}, "Jupiter", 40, 1, 0.07f},
+        {0, 0, 5, 220, 220, 220, {0, 0}, "Jupiter", 52, 2, 0.05f},
+        {0, 0, 4, 200, 200, 200, {0, 0}, "Jupiter", 65, 3, 0.04f},
+        {0, 0, 4, 230, 210, 160, {0, 0}, "Saturn", 28, 0.5f, 0.06f},
+        {0, 0, 3, 200, 220, 255, {0, 0}, "Uranus", 24, 1.2f, 0.06f},
+        {0, 0, 3, 180, 200, 255, {0, 0}, "Neptune", 22, 2.0f, 0.06f}};
+    float moonDepth[NUM_MOONS];
+    ResolveMoonParents(moons, NUM_MOONS, &store, &names);
+
+    float *asteroidX = asteroid_speed + numAsteroids;
+    float *asteroidY = asteroidX + numAsteroids;
+    float *asteroidDepth = asteroidY + numAsteroids;
+
+    const PickHit noPick = {PICK_NONE, 0, {0, 0}};
+    PickHit selected = noPick;
+    PickHit hovered = noPick;
+    PickGrid pickGrid;
+    memset(&pickGrid, 0, sizeof(pickGrid));
+    TextRun tooltip;
+    memset(&tooltip, 0, sizeof(tooltip));
+#ifdef SOLAR_PROFILE
+    PerfHud hud;
+    memset(&hud, 0, sizeof(hud));
+#endif
+    SDL_Event e;
+    Uint64 simTicks = 0;
+
+    UiLayout ui;
+    memset(&ui, 0, sizeof(ui));
+    SDL_Texture *uiTexture = NULL;
+    int uiTextureW = 0, uiTextureH = 0;
+    bool uiDirty = true;
+    SDL_Texture *sceneTexture = NULL;
+    int sceneTextureW = 0, sceneTextureH = 0;
+    bool sceneFrozen = false;
+    Uint64 frozenTick = 0;
+
+    bool addPanelOpen = false;
+    FieldId activeField = FIELD_NAME;
+    TextField fields[FIELD_COUNT] = {
+        {"NAME", "", 32, false},
+        {"ORBIT", "", 16, true},
+        {"SPEED", "", 16, true},
+        {"RADIUS", "", 16, true},
+        {"COLOR R", "", 4, true},
+        {"COLOR G", "", 4, true},
+        {"COLOR B", "", 4, true}};
+    strcpy(fields[FIELD_R].text, "200");
+    strcpy(fields[FIELD_G].text, "200");
+    strcpy(fields[FIELD_B].text, "200");
+
+    bool removePanelOpen = false;
+    bool removeConfirmOpen = false;
+    const BodyHandle noHandle = {0, 0};
+    int removeAnchor = -1; // row that shift-click ranges start from
+    int removeMarked = 0;
+    int removeConfirmCount = 0;
+    ListView removeList = {{0.0f, 0.0f, 0.0f, 0.0f}, 32.0f, 0.0, 0};
+    bool removeListDrag = false;
+    int activeFilter = -1;
+    TextField filterFields[3] = {
+        {"MIN", "", 16, true},
+        {"MAX", "", 16, true},
+        {"SEARCH", "", 32, false}};
+    char listedSearch[32] = "";
+    BodyRows removeRows = {NULL, 0, 0};
+
+    float *starX = asteroidDepth + numAsteroids;
+    float *starY = starX + numStars;
+    Uint8 *starBrightness = (Uint8 *)(starY + numStars);
+    for (int i = 0; i < numStars; i++)
+    {
+        starX[i] = (float)(rand() % WIDTH);
+        starY[i] = (float)(rand() % HEIGHT);
+        starBrightness[i] = 120 + (rand() % 136);
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    while (running)
+    {
+        PROFILE_FRAME_BEGIN();
+        HitchFrameBegin();
+        MetricsFrameBegin();
+        // while frozen, new bodies start where they were when the scene stopped
+        TRACE_BEGIN(pollStart);
+        if (CatalogWatcherPoll(&watcher, &store, &names, &pager, sceneFrozen ? frozenTick : simTicks))
+        {
+            ResolveMoonParents(moons, NUM_MOONS, &store, &names);
+            uiDirty = true;
+            TRACE_END(pollStart, "apply catalog changes");
+        }
+        simTicks++;
+        int winW = WIDTH, winH = HEIGHT;
+        if (window)
+            SDL_GetWindowSize(window, &winW, &winH);
+        if (UiLayoutUpdate(&ui, winW, winH, addPanelOpen, removePanelOpen, removeConfirmOpen))
+            uiDirty = true;
+        removeList.area = ui.rects[WIDGET_LIST];
+
+        PROFILE_BEGIN(STAGE_EVENTS);
+        while (SDL_PollEvent(&e))
+        {
+            HitchNoteEvent(e.type);
+            // plain mouse motion only reaches the UI while dragging the scrollbar
+            if (e.type != SDL_EVENT_MOUSE_MOTION || removeListDrag)
+                uiDirty = true;
+            if (e.type == SDL_EVENT_RENDER_DEVICE_RESET)
+            {
+                // textures are gone, make new ones
+                uiTextureW = 0;
+                sceneTextureW = 0;
+            }
+            else if (e.type == SDL_EVENT_RENDER_TARGETS_RESET)
+            {
+                // the textures survive but lost their pixels; the UI is redrawn
+                // anyway, the frozen scene has to be captured again
+                sceneTextureW = 0;
+            }
+#ifdef SOLAR_PROFILE
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.key == SDLK_F3)
+                hud.visible = !hud.visible;
+#endif
+            if (e.type == SDL_EVENT_QUIT)
+            {
+                running = 0;
+            }
+            else if (!addPanelOpen && !removePanelOpen &&
+                     e.type == SDL_EVENT_MOUSE_WHEEL)
             {
                 zoom += (e.wheel.y > 0 ? 0.1f : -0.1f);
                 if (zoom < 0.2f)
@@ -565,6 +6034,10 @@ int main(int argc, char *argv[])
                 if (zoom > 5.0f)
                     zoom = 5.0f;
             }
+            else if (removePanelOpen && e.type == SDL_EVENT_MOUSE_WHEEL)
+            {
+                ListViewScrollTo(&removeList, removeList.scroll - e.wheel.y * 3.0f * removeList.rowH);
+            }
             else if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN)
             {
                 if (e.button.button == SDL_BUTTON_LEFT)
@@ -576,9 +6049,12 @@ int main(int argc, char *argv[])
                 float mx = (float)e.button.x;
                 float my = (float)e.button.y;
 
+                UiLayoutUpdate(&ui, winW, winH, addPanelOpen, removePanelOpen, removeConfirmOpen);
+                WidgetId hit = UiHitTest(&ui, mx, my);
+
                 if (!addPanelOpen && !removePanelOpen)
                 {
-                    if (PointInRect(mx, my, &addButton))
+                    if (hit == WIDGET_ADD_BUTTON)
                     {
                         addPanelOpen = true;
                         removePanelOpen = false;
@@ -589,200 +6065,149 @@ int main(int argc, char *argv[])
                         fields[FIELD_SPEED].text[0] = '\0';
                         fields[FIELD_RADIUS].text[0] = '\0';
                     }
-                    else if (PointInRect(mx, my, &removeButton))
+                    else if (hit == WIDGET_REMOVE_BUTTON)
                     {
                         removePanelOpen = true;
                         removeConfirmOpen = false;
-                        removeCandidateIdx = -1;
+                        removeAnchor = -1;
+                        ClearBodyMarks(&store);
+                        removeMarked = 0;
+                        removeList.scroll = 0.0;
+                        activeFilter = -1;
                         addPanelOpen = false;
                         SDL_StopTextInput(window);
                     }
                     else
                     {
-                        selectedPlanet = -1;
-                        for (int i = 0; i < numPlanets; i++)
-                        {
-                            float dx = mx - planets[i].circle.x;
-                            float dy = my - planets[i].circle.y;
-                            if (dx * dx + dy * dy <= planets[i].screenRadius * planets[i].screenRadius)
-                                selectedPlanet = i;
-                        }
+                        selected = PickGridQuery(&pickGrid, mx, my);
+                        followPlanet = noHandle;
                     }
                 }
                 else if (addPanelOpen)
                 {
-                    int winW, winH;
-                    SDL_GetWindowSize(window, &winW, &winH);
-                    SDL_FRect panel = {
-                        winW * 0.5f - 350.0f,
-                        winH * 0.5f - 220.0f,
-                        700.0f,
-                        440.0f};
-                    float px = panel.x + 30.0f;
-                    float py = panel.y + 60.0f;
-                    float rowH = 40.0f;
-                    float labelWidth = 140.0f;
-                    SDL_FRect fieldRects[FIELD_COUNT];
-                    for (int i = 0; i < FIELD_COUNT; i++)
+                    if (hit >= WIDGET_FIELD && hit < WIDGET_FIELD + FIELD_COUNT)
                     {
-                        SDL_FRect r = {
-                            px + labelWidth,
-                            py + i * rowH,
-                            300.0f,
-                            28.0f};
-                        fieldRects[i] = r;
+                        activeField = (FieldId)(hit - WIDGET_FIELD);
                     }
-                    SDL_FRect saveBtn = {
-                        panel.x + 80.0f,
-                        panel.y + panel.h - 70.0f,
-                        180.0f,
-                        40.0f};
-                    SDL_FRect cancelBtn = {
-                        panel.x + panel.w - 260.0f,
-                        panel.y + panel.h - 70.0f,
-                        180.0f,
-                        40.0f};
-
-                    bool fieldHit = false;
-                    for (int i = 0; i < FIELD_COUNT; i++)
+                    else if (hit == WIDGET_SAVE)
                     {
-                        if (PointInRect(mx, my, &fieldRects[i]))
+                        Planet added;
+                        if (PlanetFromFields(fields, &added) && CatalogAdd(&catalog, &added))
                         {
-                            activeField = (FieldId)i;
-                            fieldHit = true;
-                            break;
-                        }
-                    }
-                    if (!fieldHit)
-                    {
-                        if (PointInRect(mx, my, &saveBtn))
-                        {
-                            if (SavePlanetFromFieldsToFile(PLANETS_FILE, fields))
+                            if (pager.running)
+                                PagedLoaderInvalidateOrbit(&pager, added.orbitRadius);
+                            else
                             {
-                                free(planets);
-                                planets = NULL;
-                                if (!LoadPlanetsFromTextFile(PLANETS_FILE, &planets, &numPlanets))
-                                {
-                                    fprintf(stderr, "Failed to reload planets after save.\n");
-                                    running = 0;
-                                }
-                                else
-                                {
-                                    ResolveMoonParents(moons, NUM_MOONS, planets, numPlanets);
-                                }
+                                BodyHandle h = BodyStoreAdd(&store, &added);
+                                NameIndexAdd(&names, h);
+                                CatalogWatcherNote(&watcher, true, &added, h);
                             }
-                            addPanelOpen = false;
-                            SDL_StopTextInput(window);
-                        }
-                        else if (PointInRect(mx, my, &cancelBtn))
-                        {
-                            addPanelOpen = false;
-                            SDL_StopTextInput(window);
+                            ResolveMoonParents(moons, NUM_MOONS, &store, &names);
                         }
+                        addPanelOpen = false;
+                        SDL_StopTextInput(window);
+                    }
+                    else if (hit == WIDGET_CANCEL)
+                    {
+                        addPanelOpen = false;
+                        SDL_StopTextInput(window);
+                    }
+                }
+                else if (removePanelOpen && removeConfirmOpen)
+                {
+                    if (hit == WIDGET_YES)
+                    {
+                        RemoveMarkedBodies(&catalog, &store, &watcher);
+                        removePanelOpen = false;
+                        removeConfirmOpen = false;
+                        SDL_StopTextInput(window);
+                    }
+                    else if (hit == WIDGET_NO)
+                    {
+                        removeConfirmOpen = false;
                     }
                 }
                 else if (removePanelOpen)
                 {
-                    int winW, winH;
-                    SDL_GetWindowSize(window, &winW, &winH);
-                    SDL_FRect panel = {
-                        winW * 0.5f - 350.0f,
-                        winH * 0.5f - 220.0f,
-                        700.0f,
-                        440.0f};
-                    SDL_FRect closeBtn = {
-                        panel.x + panel.w - 180.0f,
-                        panel.y + panel.h - 60.0f,
-                        140.0f,
-                        35.0f};
-                    bool handled = false;
-
-                    if (removeConfirmOpen && removeCandidateIdx >= 0 &&
-                        removeCandidateIdx < numPlanets)
+                    int row = hit == WIDGET_LIST ? ListViewRowAt(&removeList, mx, my) : -1;
+                    int i = BodyRowIndex(&removeRows, &store, row);
+                    if (i >= 0)
                     {
-                        SDL_FRect confirmBox = {
-                            panel.x + 50.0f,
-                            panel.y + panel.h - 150.0f,
-                            panel.w - 100.0f,
-                            70.0f};
-                        SDL_FRect yesBtn = {
-                            confirmBox.x + 40.0f,
-                            confirmBox.y + 30.0f,
-                            180.0f,
-                            30.0f};
-                        SDL_FRect noBtn = {
-                            confirmBox.x + confirmBox.w - 220.0f,
-                            confirmBox.y + 30.0f,
-                            180.0f,
-                            30.0f};
-                        if (PointInRect(mx, my, &yesBtn))
+                        // click selects, ctrl-click toggles, shift-click extends
+                        // from the last clicked row
+                        SDL_Keymod mod = SDL_GetModState();
+                        if ((mod & SDL_KMOD_SHIFT) && removeAnchor >= 0)
                         {
-                            if (RemovePlanetAtIndexInFile(PLANETS_FILE, planets, numPlanets,
-                                                          removeCandidateIdx))
+                            if (!(mod & SDL_KMOD_CTRL))
                             {
-                                free(planets);
-                                planets = NULL;
-                                if (!LoadPlanetsFromTextFile(PLANETS_FILE, &planets, &numPlanets))
-                                {
-                                    fprintf(stderr, "Failed to reload planets after removal.\n");
-                                    running = 0;
-                                }
-                                else
-                                {
-                                    ResolveMoonParents(moons, NUM_MOONS, planets, numPlanets);
-                                }
+                                ClearBodyMarks(&store);
+                                removeMarked = 0;
                             }
-                            removePanelOpen = false;
-                            removeConfirmOpen = false;
-                            removeCandidateIdx = -1;
-                            handled = true;
+                            removeMarked += MarkBodyRange(&store, &removeRows, removeAnchor, row);
                         }
-                        else if (PointInRect(mx, my, &noBtn))
+                        else if (mod & SDL_KMOD_CTRL)
                         {
-                            removeConfirmOpen = false;
-                            removeCandidateIdx = -1;
-                            handled = true;
+                            store.bodies[i].marked = !store.bodies[i].marked;
+                            removeMarked += store.bodies[i].marked ? 1 : -1;
+                            removeAnchor = row;
                         }
-                    }
-
-                    if (!handled && !removeConfirmOpen)
-                    {
-                        float px = panel.x + 30.0f;
-                        float py = panel.y + 60.0f;
-                        float rowH = 32.0f;
-                        int maxRows = (int)((panel.h - 140.0f) / rowH);
-                        if (maxRows > numPlanets)
-                            maxRows = numPlanets;
-
-                        bool rowHit = false;
-                        for (int i = 0; i < maxRows; i++)
+                        else
                         {
-                            SDL_FRect rowRect = {
-                                px,
-                                py + i * rowH,
-                                panel.w - 60.0f,
-                                rowH - 4.0f};
-                            if (PointInRect(mx, my, &rowRect))
-                            {
-                                removeCandidateIdx = i;
-                                removeConfirmOpen = true;
-                                rowHit = true;
-                                break;
-                            }
+                            ClearBodyMarks(&store);
+                            store.bodies[i].marked = true;
+                            removeMarked = 1;
+                            removeAnchor = row;
                         }
-                        if (!rowHit && PointInRect(mx, my, &closeBtn))
+                        activeFilter = -1;
+                    }
+                    else if (hit == WIDGET_LIST_TRACK)
+                    {
+                        removeListDrag = true;
+                        ListViewScrollToThumb(&removeList, my);
+                    }
+                    else if (hit >= WIDGET_FILTER && hit < WIDGET_FILTER + 3)
+                    {
+                        activeFilter = hit - WIDGET_FILTER;
+                        SDL_StartTextInput(window);
+                    }
+                    else if (hit == WIDGET_SELECT)
+                    {
+                        float lo = filterFields[0].text[0] ? (float)atof(filterFields[0].text) : -INFINITY;
+                        float hi = filterFields[1].text[0] ? (float)atof(filterFields[1].text) : INFINITY;
+                        removeMarked = MarkBodiesInOrbitRange(&store, &removeRows, lo, hi);
+                    }
+                    else if (hit == WIDGET_GOTO)
+                    {
+                        int target = BodyRowIndex(&removeRows, &store, removeAnchor >= 0 ? removeAnchor : 0);
+                        if (target >= 0)
                         {
+                            selected.kind = PICK_PLANET;
+                            selected.planet = BodyStoreHandleAt(&store, target);
+                            followPlanet = selected.planet;
                             removePanelOpen = false;
-                            removeConfirmOpen = false;
-                            removeCandidateIdx = -1;
+                            SDL_StopTextInput(window);
                         }
                     }
+                    else if (hit == WIDGET_DELETE)
+                    {
+                        removeConfirmCount = CountMarkedBodies(&store);
+                        removeConfirmOpen = removeConfirmCount > 0;
+                    }
+                    else if (hit == WIDGET_CLOSE)
+                    {
+                        removePanelOpen = false;
+                        removeConfirmOpen = false;
+                        SDL_StopTextInput(window);
+                    }
                 }
             }
             else if (e.type == SDL_EVENT_MOUSE_BUTTON_UP)
             {
                 if (e.button.button == SDL_BUTTON_LEFT)
+                {
                     mouseLeft = 0;
+                    removeListDrag = false;
+                }
                 if (e.button.button == SDL_BUTTON_RIGHT)
                     mouseRight = 0;
             }
@@ -795,6 +6220,11 @@ int main(int argc, char *argv[])
                 int dy = my - lastY;
                 lastX = mx;
                 lastY = my;
+                // nothing in the scene is hovered through a button
+                if (UiHitTest(&ui, e.motion.x, e.motion.y) == WIDGET_NONE)
+                    hovered = PickGridNearest(&pickGrid, e.motion.x, e.motion.y, PICK_HOVER_DISTANCE);
+                else
+                    hovered = noPick;
                 if (mouseLeft)
                 {
                     camYaw += dx * ROTATE_SENS;
@@ -806,26 +6236,22 @@ int main(int argc, char *argv[])
                 }
                 if (mouseRight)
                 {
+                    followPlanet = noHandle;
                     camPanX += dx * PAN_SENS;
                     camPanY += dy * PAN_SENS;
                 }
             }
+            else if (removePanelOpen && removeListDrag && e.type == SDL_EVENT_MOUSE_MOTION)
+            {
+                ListViewScrollToThumb(&removeList, e.motion.y);
+            }
             else if (addPanelOpen && e.type == SDL_EVENT_TEXT_INPUT)
             {
-                TextField *tf = &fields[activeField];
-                int len = (int)strlen(tf->text);
-                const char *p = e.text.text;
-                while (*p && len < tf->maxLen - 1)
-                {
-                    char ch = *p++;
-                    if (tf->numericOnly)
-                    {
-                        if (!((ch >= '0' && ch <= '9') || ch == '.' || ch == '-'))
-                            continue;
-                    }
-                    tf->text[len++] = ch;
-                    tf->text[len] = '\0';
-                }
+                AppendTextInput(&fields[activeField], e.text.text);
+            }
+            else if (removePanelOpen && activeFilter >= 0 && e.type == SDL_EVENT_TEXT_INPUT)
+            {
+                AppendTextInput(&filterFields[activeFilter], e.text.text);
             }
             else if (addPanelOpen && e.type == SDL_EVENT_KEY_DOWN)
             {
@@ -843,19 +6269,18 @@ int main(int argc, char *argv[])
                 }
                 else if (key == SDLK_RETURN || key == SDLK_KP_ENTER)
                 {
-                    if (SavePlanetFromFieldsToFile(PLANETS_FILE, fields))
+                    Planet added;
+                    if (PlanetFromFields(fields, &added) && CatalogAdd(&catalog, &added))
                     {
-                        free(planets);
-                        planets = NULL;
-                        if (!LoadPlanetsFromTextFile(PLANETS_FILE, &planets, &numPlanets))
-                        {
-                            fprintf(stderr, "Failed to reload planets after save.\n");
-                            running = 0;
-                        }
+                        if (pager.running)
+                            PagedLoaderInvalidateOrbit(&pager, added.orbitRadius);
                         else
                         {
-                            ResolveMoonParents(moons, NUM_MOONS, planets, numPlanets);
+                            BodyHandle h = BodyStoreAdd(&store, &added);
+                            NameIndexAdd(&names, h);
+                            CatalogWatcherNote(&watcher, true, &added, h);
                         }
+                        ResolveMoonParents(moons, NUM_MOONS, &store, &names);
                     }
                     addPanelOpen = false;
                     SDL_StopTextInput(window);
@@ -874,43 +6299,88 @@ int main(int argc, char *argv[])
                     if (removeConfirmOpen)
                     {
                         removeConfirmOpen = false;
-                        removeCandidateIdx = -1;
+                    }
+                    else if (activeFilter >= 0)
+                    {
+                        activeFilter = -1;
                     }
                     else
                     {
                         removePanelOpen = false;
-                        removeConfirmOpen = false;
-                        removeCandidateIdx = -1;
+                        SDL_StopTextInput(window);
                     }
                 }
-                else if ((key == SDLK_RETURN || key == SDLK_KP_ENTER) &&
-                         removeConfirmOpen && removeCandidateIdx >= 0 &&
-                         removeCandidateIdx < numPlanets)
+                else if ((key == SDLK_RETURN || key == SDLK_KP_ENTER) && removeConfirmOpen)
                 {
-                    if (RemovePlanetAtIndexInFile(PLANETS_FILE, planets, numPlanets,
-                                                  removeCandidateIdx))
-                    {
-                        free(planets);
-                        planets = NULL;
-                        if (!LoadPlanetsFromTextFile(PLANETS_FILE, &planets, &numPlanets))
-                        {
-                            fprintf(stderr, "Failed to reload planets after removal.\n");
-                            running = 0;
-                        }
-                        else
-                        {
-                            ResolveMoonParents(moons, NUM_MOONS, planets, numPlanets);
-                        }
-                    }
+                    RemoveMarkedBodies(&catalog, &store, &watcher);
                     removePanelOpen = false;
                     removeConfirmOpen = false;
-                    removeCandidateIdx = -1;
+                    SDL_StopTextInput(window);
+                }
+                else if ((key == SDLK_RETURN || key == SDLK_KP_ENTER) && activeFilter == 2)
+                {
+                    // enter in the search box goes to the first match
+                    int target = BodyRowIndex(&removeRows, &store, 0);
+                    if (target >= 0)
+                    {
+                        selected.kind = PICK_PLANET;
+                        selected.planet = BodyStoreHandleAt(&store, target);
+                        followPlanet = selected.planet;
+                        removePanelOpen = false;
+                        SDL_StopTextInput(window);
+                    }
+                }
+                else if ((key == SDLK_RETURN || key == SDLK_KP_ENTER) && activeFilter >= 0)
+                {
+                    float lo = filterFields[0].text[0] ? (float)atof(filterFields[0].text) : -INFINITY;
+                    float hi = filterFields[1].text[0] ? (float)atof(filterFields[1].text) : INFINITY;
+                    removeMarked = MarkBodiesInOrbitRange(&store, &removeRows, lo, hi);
+                }
+                else if (key == SDLK_BACKSPACE && activeFilter >= 0)
+                {
+                    int len = (int)strlen(filterFields[activeFilter].text);
+                    if (len > 0)
+                        filterFields[activeFilter].text[len - 1] = '\0';
+                }
+                else if (key == SDLK_TAB && activeFilter >= 0)
+                {
+                    activeFilter = (activeFilter + 1) % 3;
+                }
+                else if (key == SDLK_UP || key == SDLK_DOWN)
+                {
+                    float step = key == SDLK_UP ? -removeList.rowH : removeList.rowH;
+                    ListViewScrollTo(&removeList, removeList.scroll + step);
+                }
+                else if (key == SDLK_PAGEUP || key == SDLK_PAGEDOWN)
+                {
+                    float step = key == SDLK_PAGEUP ? -removeList.area.h : removeList.area.h;
+                    ListViewScrollTo(&removeList, removeList.scroll + step);
+                }
+                else if (key == SDLK_HOME || key == SDLK_END)
+                {
+                    ListViewScrollTo(&removeList, key == SDLK_HOME ? 0.0 : ListViewMaxScroll(&removeList));
+                }
+                else if (key == SDLK_DELETE && !removeConfirmOpen)
+                {
+                    removeConfirmCount = CountMarkedBodies(&store);
+                    removeConfirmOpen = removeConfirmCount > 0;
+                }
+                else if (key == SDLK_A && (e.key.mod & SDL_KMOD_CTRL) && activeFilter < 0 &&
+                         removeRows.count > 0)
+                {
+                    removeMarked += MarkBodyRange(&store, &removeRows, 0, removeRows.count - 1);
                 }
             }
         }
+        PROFILE_END(STAGE_EVENTS);
 
-        int winW, winH;
-        SDL_GetWindowSize(window, &winW, &winH);
+        if (window)
+            SDL_GetWindowSize(window, &winW, &winH);
+        if (bench)
+            BenchCamera(bench, simTicks, &camYaw, &camPitch, &zoom);
+        if (UiLayoutUpdate(&ui, winW, winH, addPanelOpen, removePanelOpen, removeConfirmOpen))
+            uiDirty = true;
+        removeList.area = ui.rects[WIDGET_LIST];
         float cx = winW / 2.0f;
         float cy = winH / 2.0f;
         float fov = BASE_FOV * zoom;
@@ -920,365 +6390,701 @@ int main(int argc, char *argv[])
         float cosPitch = cosf(camPitch);
         float sinPitch = sinf(camPitch);
 
-        ProjectXZ3D(0, 0, cosYaw, sinYaw, cosPitch, sinPitch,
-                    CAM_DIST, fov, cx, cy, camPanX, camPanY,
-                    &sunScreenX, &sunScreenY, &sunDepth);
-        sunScreenRadius = sun.radius * (fov / sunDepth);
-
-        for (int i = 0; i < numPlanets; i++)
+        if (removePanelOpen)
         {
-            Planet *p = &planets[i];
-            p->angle += p->angularSpeed;
-            p->worldX = cosf(p->angle) * p->orbitRadius;
-            p->worldZ = sinf(p->angle) * p->orbitRadius;
-            ProjectXZ3D(p->worldX, p->worldZ,
-                        cosYaw, sinYaw, cosPitch, sinPitch,
-                        CAM_DIST, fov, cx, cy, camPanX, camPanY,
-                        &p->circle.x, &p->circle.y, &p->depth);
-            p->screenRadius = p->circle.radius * (fov / p->depth);
+            // a new search starts a new selection
+            if (strcmp(listedSearch, filterFields[2].text) != 0)
+            {
+                strcpy(listedSearch, filterFields[2].text);
+                ClearBodyMarks(&store);
+                removeMarked = 0;
+                removeAnchor = -1;
+                removeList.scroll = 0.0;
+            }
+            removeRows = BodyRowsFor(&names, &store, listedSearch);
+            ListViewSetCount(&removeList, removeRows.count);
         }
 
-        for (int i = 0; i < NUM_ASTEROIDS; i++)
+        // behind a modal panel the scene is drawn once into a texture and left
+        // alone; when the panel closes the bodies catch up on the skipped ticks
+        bool modalOpen = addPanelOpen || removePanelOpen;
+        if (sceneFrozen && (!modalOpen || sceneTextureW != winW || sceneTextureH != winH))
+        {
+            // this frame still runs its own tick below
+            float missed = (float)(simTicks - frozenTick - 1);
+            for (int i = 0; i < store.count; i++)
+            {
+                Planet *p = &store.bodies[i];
+                p->angle = fmodf(p->angle + p->angularSpeed * missed, 6.283185f);
+            }
+            for (int i = 0; i < NUM_MOONS; i++)
+                moons[i].angle = fmodf(moons[i].angle + moons[i].angularSpeed * missed, 6.283185f);
+            for (int i = 0; i < numAsteroids; i++)
+                asteroid_angle[i] = fmodf(asteroid_angle[i] + asteroid_speed[i] * missed, 6.283185f);
+            sceneFrozen = false;
+        }
+        if (freezeBehindPanels && (sceneTextureW != winW || sceneTextureH != winH))
         {
-            asteroid_angle[i] += asteroid_speed[i];
+            if (sceneTexture)
+                SDL_DestroyTexture(sceneTexture);
+            sceneTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                             SDL_TEXTUREACCESS_TARGET, winW, winH);
+            if (sceneTexture)
+                SDL_SetTextureBlendMode(sceneTexture, SDL_BLENDMODE_NONE);
+            sceneTextureW = winW;
+            sceneTextureH = winH;
         }
 
-        for (int i = 0; i < NUM_MOONS; i++)
+        if (!sceneFrozen)
         {
-            struct Moon *m = &moons[i];
-            m->angle += m->angularSpeed;
-            if (m->parentIndex < 0 || m->parentIndex >= numPlanets)
+            // the first frame behind a panel goes into the snapshot
+            bool capture = modalOpen && sceneTexture && SDL_SetRenderTarget(renderer, sceneTexture);
+
+            PROFILE_BEGIN(STAGE_PROJECT);
+            Planet *followed = BodyStoreGet(&store, followPlanet);
+            if (followed)
             {
-                moonDepth[i] = 1.0f;
-                continue;
+                // pan so the body lands on the centre of the screen once it has moved
+                float fx, fy, fd;
+                float angle = followed->angle + followed->angularSpeed;
+                float wx = cosf(angle) * followed->orbitRadius;
+                float wz = sinf(angle) * followed->orbitRadius;
+                ProjectXZ3D(wx, wz, cosYaw, sinYaw, cosPitch, sinPitch,
+                            CAM_DIST, fov, cx, cy, 0.0f, 0.0f, &fx, &fy, &fd);
+                camPanX = cx - fx;
+                camPanY = cy - fy;
             }
-            Planet *parent = &planets[m->parentIndex];
-            float mwx = parent->worldX + cosf(m->angle) * m->orbitRadius;
-            float mwz = parent->worldZ + sinf(m->angle) * m->orbitRadius;
-            ProjectXZ3D(mwx, mwz,
-                        cosYaw, sinYaw, cosPitch, sinPitch,
-                        CAM_DIST, fov, cx, cy, camPanX, camPanY,
-                        &m->x, &m->y, &moonDepth[i]);
-        }
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
 
-        for (int i = 0; i < NUM_STARS; i++)
-        {
-            Uint8 b = starBrightness[i];
-            SDL_SetRenderDrawColor(renderer, b, b, b, 255);
+            ProjectXZ3D(0, 0, cosYaw, sinYaw, cosPitch, sinPitch,
+                        CAM_DIST, fov, cx, cy, camPanX, camPanY,
+                        &sunScreenX, &sunScreenY, &sunDepth);
+            sunScreenRadius = sun.radius * (fov / sunDepth);
+            PROFILE_END(STAGE_PROJECT);
 
-            float sx = starX[i] + camPanX * 0.03f;
-            float sy = starY[i] + camPanY * 0.03f;
+            PROFILE_BEGIN(STAGE_UPDATE);
+            if (pager.running &&
+                PagedLoaderUpdate(&pager, &store, fov, CAM_DIST, sinPitch,
+                                  sunScreenX, sunScreenY, winW, winH))
+            {
+                NameIndexInvalidate(&names);
+                ResolveMoonParents(moons, NUM_MOONS, &store, &names);
+                uiDirty = true;
+            }
 
-            // wrap around screen edges
-            if (sx < 0)
-                sx += winW;
-            if (sx >= winW)
-                sx -= winW;
-            if (sy < 0)
-                sy += winH;
-            if (sy >= winH)
-                sy -= winH;
+            for (int i = 0; i < store.count; i++)
+            {
+                Planet *p = &store.bodies[i];
+                p->angle += p->angularSpeed;
+                p->worldX = cosf(p->angle) * p->orbitRadius;
+                p->worldZ = sinf(p->angle) * p->orbitRadius;
+            }
+            for (int i = 0; i < numAsteroids; i++)
+                asteroid_angle[i] += asteroid_speed[i];
+            for (int i = 0; i < NUM_MOONS; i++)
+                moons[i].angle += moons[i].angularSpeed;
+            PROFILE_COUNT(bodiesSimulated, store.count + NUM_MOONS);
+            MetricsSimulated(store.count, NUM_MOONS, numAsteroids);
+            PROFILE_END(STAGE_UPDATE);
 
-            SDL_RenderPoint(renderer, sx, sy);
-        }
+            PROFILE_BEGIN(STAGE_PROJECT);
+            if (store.count > 0)
+            {
+                Planet *b = store.bodies;
+                ProjectXZ3DBatch(store.count, &b->worldX, &b->worldZ, sizeof(Planet),
+                                 cosYaw, sinYaw, cosPitch, sinPitch,
+                                 CAM_DIST, fov, cx, cy, camPanX, camPanY,
+                                 &b->circle.x, &b->circle.y, &b->depth, sizeof(Planet));
+            }
+            for (int i = 0; i < store.count; i++)
+            {
+                Planet *p = &store.bodies[i];
+                p->screenRadius = p->circle.radius * (fov / p->depth);
+            }
 
-        SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
-        const int SEG = 48;
-        for (int i = 0; i < numPlanets; i++)
-        {
-            float r = planets[i].orbitRadius;
-            float px = 0, py = 0;
-            int hasPrev = 0;
-            for (int s = 0; s <= SEG; s++)
+            for (int i = 0; i < numAsteroids; i++)
             {
-                float t = (float)s / SEG * 6.283185f;
-                float wx = cosf(t) * r;
-                float wz = sinf(t) * r;
-                float sx, sy, d;
+                float wx = cosf(asteroid_angle[i]) * asteroid_radius[i];
+                float wz = sinf(asteroid_angle[i]) * asteroid_radius[i];
                 ProjectXZ3D(wx, wz,
                             cosYaw, sinYaw, cosPitch, sinPitch,
                             CAM_DIST, fov, cx, cy, camPanX, camPanY,
-                            &sx, &sy, &d);
-                if (hasPrev)
-                    SDL_RenderLine(renderer, px, py, sx, sy);
-                px = sx;
-                py = sy;
-                hasPrev = 1;
+                            &asteroidX[i], &asteroidY[i], &asteroidDepth[i]);
             }
-        }
 
-        SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
-        for (int i = 0; i < NUM_ASTEROIDS; i++)
-        {
-            float wx = cosf(asteroid_angle[i]) * asteroid_radius[i];
-            float wz = sinf(asteroid_angle[i]) * asteroid_radius[i];
-            float sx, sy, d;
-            ProjectXZ3D(wx, wz,
-                        cosYaw, sinYaw, cosPitch, sinPitch,
-                        CAM_DIST, fov, cx, cy, camPanX, camPanY,
-                        &sx, &sy, &d);
-            if ((i & 1) == 0)
-                SDL_RenderPoint(renderer, sx, sy);
-        }
+            for (int i = 0; i < NUM_MOONS; i++)
+            {
+                struct Moon *m = &moons[i];
+                Planet *parent = BodyStoreGet(&store, m->parent);
+                if (!parent)
+                {
+                    moonDepth[i] = 1.0f;
+                    continue;
+                }
+                float mwx = parent->worldX + cosf(m->angle) * m->orbitRadius;
+                float mwz = parent->worldZ + sinf(m->angle) * m->orbitRadius;
+                ProjectXZ3D(mwx, mwz,
+                            cosYaw, sinYaw, cosPitch, sinPitch,
+                            CAM_DIST, fov, cx, cy, camPanX, camPanY,
+                            &m->x, &m->y, &moonDepth[i]);
+            }
+
+            // picking runs against what this frame draws
+            PickGridBegin(&pickGrid, winW, winH);
+            for (int i = 0; i < store.count; i++)
+            {
+                Planet *p = &store.bodies[i];
+                PickHit hit = {PICK_PLANET, 0, BodyStoreHandleAt(&store, i)};
+                PickGridAdd(&pickGrid, p->circle.x, p->circle.y, p->screenRadius, p->depth, hit);
+            }
+            for (int i = 0; i < NUM_MOONS; i++)
+            {
+                if (!BodyStoreGet(&store, moons[i].parent))
+                    continue;
+                PickHit hit = {PICK_MOON, i, {0, 0}};
+                PickGridAdd(&pickGrid, moons[i].x, moons[i].y, moons[i].radius * (fov / moonDepth[i]),
+                            moonDepth[i], hit);
+            }
+            for (int i = 0; i < numAsteroids; i += 2)
+            {
+                PickHit hit = {PICK_ASTEROID, i, {0, 0}};
+                PickGridAdd(&pickGrid, asteroidX[i], asteroidY[i], 1.0f, asteroidDepth[i], hit);
+            }
+            PickGridBuild(&pickGrid);
+            PROFILE_END(STAGE_PROJECT);
 
-        SDL_SetRenderDrawColor(renderer, 40, 40, 120, 255);
-        SDL_RenderFillRect(renderer, &addButton);
-        SDL_SetRenderDrawColor(renderer, 220, 220, 255, 255);
-        SDL_RenderRect(renderer, &addButton);
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        DrawText(renderer, addButton.x + 20, addButton.y + 12, "ADD PLANET", 2.0f);
+            PROFILE_BEGIN(STAGE_STARS);
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
 
-        SDL_SetRenderDrawColor(renderer, 120, 40, 40, 255);
-        SDL_RenderFillRect(renderer, &removeButton);
-        SDL_SetRenderDrawColor(renderer, 255, 220, 220, 255);
-        SDL_RenderRect(renderer, &removeButton);
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        DrawText(renderer, removeButton.x + 8, removeButton.y + 12, "REMOVE PLANET", 2.0f);
+            for (int i = 0; i < numStars; i++)
+            {
+                Uint8 b = starBrightness[i];
+                SDL_SetRenderDrawColor(renderer, b, b, b, 255);
 
-        if (selectedPlanet >= 0 && selectedPlanet < numPlanets)
-        {
-            Planet *p = &planets[selectedPlanet];
-            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawCircle(renderer, p->circle.x, p->circle.y, p->screenRadius + 6);
-        }
+                float sx = starX[i] + camPanX * 0.03f;
+                float sy = starY[i] + camPanY * 0.03f;
 
-        // draw sun first
-SDL_SetRenderDrawColor(renderer, sun.r, sun.g, sun.b, 255);
-DrawFillCircle(renderer, sunScreenX, sunScreenY, sunScreenRadius);
+                // wrap around screen edges
+                if (sx < 0)
+                    sx += winW;
+                if (sx >= winW)
+                    sx -= winW;
+                if (sy < 0)
+                    sy += winH;
+                if (sy >= winH)
+                    sy -= winH;
 
-// only hide planets behind the sun when view is horizontal
-bool horizontalView = fabsf(camPitch) < HORIZONTAL_PITCH_LIMIT;
+                SDL_RenderPoint(renderer, sx, sy);
+            }
+            PROFILE_END(STAGE_STARS);
 
-for (int i = 0; i < numPlanets; i++)
-{
-    Planet *p = &planets[i];
+            PROFILE_BEGIN(STAGE_ORBITS);
+            SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
+            const int SEG = 48;
+            for (int i = 0; i < store.count; i++)
+            {
+                float r = store.bodies[i].orbitRadius;
+                float px = 0, py = 0;
+                int hasPrev = 0;
+                for (int s = 0; s <= SEG; s++)
+                {
+                    float t = (float)s / SEG * 6.283185f;
+                    float wx = cosf(t) * r;
+                    float wz = sinf(t) * r;
+                    float sx, sy, d;
+                    ProjectXZ3D(wx, wz,
+                                cosYaw, sinYaw, cosPitch, sinPitch,
+                                CAM_DIST, fov, cx, cy, camPanX, camPanY,
+                                &sx, &sy, &d);
+                    if (hasPrev)
+                        SDL_RenderLine(renderer, px, py, sx, sy);
+                    px = sx;
+                    py = sy;
+                    hasPrev = 1;
+                }
+            }
+            PROFILE_END(STAGE_ORBITS);
 
-    float alpha = 1.0f;
+            PROFILE_BEGIN(STAGE_ASTEROIDS);
+            SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+            for (int i = 0; i < numAsteroids; i += 2)
+            {
+                SDL_RenderPoint(renderer, asteroidX[i], asteroidY[i]);
+            }
+            PROFILE_END(STAGE_ASTEROIDS);
 
-    if (horizontalView && p->depth > sunDepth)
-    {
-        alpha = SmoothOcclusionAlpha(
-            p->circle.x, p->circle.y, p->screenRadius,
-            sunScreenX, sunScreenY, sunScreenRadius
-        );
-    }
+            PROFILE_BEGIN(STAGE_BODIES);
+            // ring the selected body in white and the one under the mouse in grey
+            for (int k = 0; k < 2; k++)
+            {
+                PickHit hit = k == 0 ? hovered : selected;
+                if (k == 0 && PickHitEquals(hovered, selected))
+                    continue;
+                float hx, hy, hr;
+                if (hit.kind == PICK_PLANET)
+                {
+                    Planet *p = BodyStoreGet(&store, hit.planet);
+                    if (!p)
+                        continue;
+                    hx = p->circle.x;
+                    hy = p->circle.y;
+                    hr = p->screenRadius;
+                }
+                else if (hit.kind == PICK_MOON)
+                {
+                    if (!BodyStoreGet(&store, moons[hit.index].parent))
+                        continue;
+                    hx = moons[hit.index].x;
+                    hy = moons[hit.index].y;
+                    hr = moons[hit.index].radius * (fov / moonDepth[hit.index]);
+                }
+                else if (hit.kind == PICK_ASTEROID)
+                {
+                    hx = asteroidX[hit.index];
+                    hy = asteroidY[hit.index];
+                    hr = 1.0f;
+                }
+                else
+                {
+                    continue;
+                }
+                if (k == 0)
+                    SDL_SetRenderDrawColor(renderer, 140, 140, 140, 255);
+                else
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawCircle(renderer, hx, hy, hr + 6);
+            }
 
-    if (alpha <= 0.01f)
-        continue;
+            // draw sun first
+            SDL_SetRenderDrawColor(renderer, sun.r, sun.g, sun.b, 255);
+            DrawFillCircle(renderer, sunScreenX, sunScreenY, sunScreenRadius);
 
-    Uint8 a = (Uint8)(alpha * 255.0f);
+            // only hide planets behind the sun when view is horizontal
+            bool horizontalView = fabsf(camPitch) < HORIZONTAL_PITCH_LIMIT;
 
-    SDL_SetRenderDrawColor(renderer,
-                           p->circle.r,
-                           p->circle.g,
-                           p->circle.b,
-                           a);
-    DrawFillCircle(renderer, p->circle.x, p->circle.y, p->screenRadius);
-}
+            for (int i = 0; i < store.count; i++)
+            {
+                Planet *p = &store.bodies[i];
 
+                float alpha = 1.0f;
 
+                if (horizontalView && p->depth > sunDepth)
+                {
+                    alpha = SmoothOcclusionAlpha(
+                        p->circle.x, p->circle.y, p->screenRadius,
+                        sunScreenX, sunScreenY, sunScreenRadius
+                    );
+                }
 
-        for (int i = 0; i < NUM_MOONS; i++)
-        {
-            float r = moons[i].radius * (fov / moonDepth[i]);
-            SDL_SetRenderDrawColor(renderer, moons[i].r, moons[i].g, moons[i].b, 255);
-            DrawFillCircle(renderer, moons[i].x, moons[i].y, r);
-        }
+                if (alpha <= 0.01f)
+                    continue;
+                if (p->circle.x + p->screenRadius < 0.0f || p->circle.x - p->screenRadius > winW ||
+                    p->circle.y + p->screenRadius < 0.0f || p->circle.y - p->screenRadius > winH)
+                    continue;
+                PROFILE_COUNT(bodiesDrawn, 1);
 
-        if (addPanelOpen)
-        {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
-            SDL_FRect overlay = {0, 0, (float)winW, (float)winH};
-            SDL_RenderFillRect(renderer, &overlay);
+                Uint8 a = (Uint8)(alpha * 255.0f);
 
-            SDL_FRect panel = {
-                winW * 0.5f - 350.0f,
-                winH * 0.5f - 220.0f,
-                700.0f,
-                440.0f};
-            SDL_SetRenderDrawColor(renderer, 30, 30, 30, 240);
-            SDL_RenderFillRect(renderer, &panel);
-            SDL_SetRenderDrawColor(renderer, 220, 220, 220, 255);
-            SDL_RenderRect(renderer, &panel);
-            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawText(renderer, panel.x + 20, panel.y + 15, "ADD NEW PLANET", 2.5f);
+                SDL_SetRenderDrawColor(renderer,
+                                       p->circle.r,
+                                       p->circle.g,
+                                       p->circle.b,
+                                       a);
+                DrawFillCircle(renderer, p->circle.x, p->circle.y, p->screenRadius);
+            }
 
-            float px = panel.x + 30.0f;
-            float py = panel.y + 60.0f;
-            float rowH = 40.0f;
-            float labelWidth = 140.0f;
+            for (int i = 0; i < NUM_MOONS; i++)
+            {
+                float r = moons[i].radius * (fov / moonDepth[i]);
+                if (moons[i].x + r < 0.0f || moons[i].x - r > winW ||
+                    moons[i].y + r < 0.0f || moons[i].y - r > winH)
+                    continue;
+                PROFILE_COUNT(bodiesDrawn, 1);
+                SDL_SetRenderDrawColor(renderer, moons[i].r, moons[i].g, moons[i].b, 255);
+                DrawFillCircle(renderer, moons[i].x, moons[i].y, r);
+            }
+            PROFILE_END(STAGE_BODIES);
 
-            for (int i = 0; i < FIELD_COUNT; i++)
+            if (capture)
             {
-                float y = py + i * rowH;
-                SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
-                DrawText(renderer, px, y, fields[i].label, 1.8f);
+                SDL_SetRenderTarget(renderer, NULL);
+                sceneFrozen = true;
+                frozenTick = simTicks;
+            }
+        }
+        if (sceneFrozen)
+            SDL_RenderTexture(renderer, sceneTexture, NULL, NULL);
 
-                SDL_FRect box = {
-                    px + labelWidth,
-                    y,
-                    300.0f,
-                    28.0f};
-                if (i == activeField)
-                {
-                    SDL_SetRenderDrawColor(renderer, 80, 80, 160, 255);
-                    SDL_RenderFillRect(renderer, &box);
-                    SDL_SetRenderDrawColor(renderer, 230, 230, 255, 255);
-                }
-                else
-                {
-                    SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
-                    SDL_RenderFillRect(renderer, &box);
-                    SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
-                }
-                SDL_RenderRect(renderer, &box);
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                DrawText(renderer, box.x + 4, box.y + 5, fields[i].text, 1.8f);
+        PROFILE_BEGIN(STAGE_UI);
+        // the UI lives in its own texture, redrawn only when something in it
+        // changed; drawing straight to the screen is the fallback
+        if (uiTextureW != winW || uiTextureH != winH)
+        {
+            if (uiTexture)
+                SDL_DestroyTexture(uiTexture);
+            uiTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                          SDL_TEXTUREACCESS_TARGET, winW, winH);
+            // drawing over transparent black leaves premultiplied colours
+            if (uiTexture)
+                SDL_SetTextureBlendMode(uiTexture, SDL_BLENDMODE_BLEND_PREMULTIPLIED);
+            uiTextureW = winW;
+            uiTextureH = winH;
+            uiDirty = true;
+        }
+        if (uiDirty)
+        {
+            bool toTexture = uiTexture && SDL_SetRenderTarget(renderer, uiTexture);
+            if (toTexture)
+            {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+                SDL_RenderClear(renderer);
             }
 
-            SDL_FRect saveBtn = {
-                panel.x + 80.0f,
-                panel.y + panel.h - 70.0f,
-                180.0f,
-                40.0f};
-            SDL_FRect cancelBtn = {
-                panel.x + panel.w - 260.0f,
-                panel.y + panel.h - 70.0f,
-                180.0f,
-                40.0f};
-
-            SDL_SetRenderDrawColor(renderer, 40, 120, 40, 255);
-            SDL_RenderFillRect(renderer, &saveBtn);
-            SDL_SetRenderDrawColor(renderer, 220, 255, 220, 255);
-            SDL_RenderRect(renderer, &saveBtn);
+            const SDL_FRect *addButton = &ui.rects[WIDGET_ADD_BUTTON];
+            const SDL_FRect *removeButton = &ui.rects[WIDGET_REMOVE_BUTTON];
+            SDL_SetRenderDrawColor(renderer, 40, 40, 120, 255);
+            SDL_RenderFillRect(renderer, addButton);
+            SDL_SetRenderDrawColor(renderer, 220, 220, 255, 255);
+            SDL_RenderRect(renderer, addButton);
             SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawText(renderer, saveBtn.x + 40, saveBtn.y + 12, "SAVE", 2.0f);
+            DrawText(renderer, addButton->x + 20, addButton->y + 12, "ADD PLANET", 2.0f);
 
             SDL_SetRenderDrawColor(renderer, 120, 40, 40, 255);
-            SDL_RenderFillRect(renderer, &cancelBtn);
+            SDL_RenderFillRect(renderer, removeButton);
             SDL_SetRenderDrawColor(renderer, 255, 220, 220, 255);
-            SDL_RenderRect(renderer, &cancelBtn);
+            SDL_RenderRect(renderer, removeButton);
             SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawText(renderer, cancelBtn.x + 25, cancelBtn.y + 12, "CANCEL", 2.0f);
-        }
-
-        if (removePanelOpen)
-        {
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
-            SDL_FRect overlay = {0, 0, (float)winW, (float)winH};
-            SDL_RenderFillRect(renderer, &overlay);
+            DrawText(renderer, removeButton->x + 8, removeButton->y + 12, "REMOVE PLANET", 2.0f);
 
-            SDL_FRect panel = {
-                winW * 0.5f - 350.0f,
-                winH * 0.5f - 220.0f,
-                700.0f,
-                440.0f};
-            SDL_SetRenderDrawColor(renderer, 30, 30, 30, 240);
-            SDL_RenderFillRect(renderer, &panel);
-            SDL_SetRenderDrawColor(renderer, 220, 220, 220, 255);
-            SDL_RenderRect(renderer, &panel);
-
-            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawText(renderer, panel.x + 20, panel.y + 15, "REMOVE PLANET", 2.5f);
+            if (addPanelOpen)
+            {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+                SDL_FRect overlay = {0, 0, (float)winW, (float)winH};
+                SDL_RenderFillRect(renderer, &overlay);
 
-            float px = panel.x + 30.0f;
-            float py = panel.y + 60.0f;
-            float rowH = 32.0f;
-            int maxRows = (int)((panel.h - 140.0f) / rowH);
-            if (maxRows > numPlanets)
-                maxRows = numPlanets;
+                SDL_FRect panel = ui.rects[WIDGET_PANEL];
+                SDL_SetRenderDrawColor(renderer, 30, 30, 30, 240);
+                SDL_RenderFillRect(renderer, &panel);
+                SDL_SetRenderDrawColor(renderer, 220, 220, 220, 255);
+                SDL_RenderRect(renderer, &panel);
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawText(renderer, panel.x + 20, panel.y + 15, "ADD NEW PLANET", 2.5f);
 
-            for (int i = 0; i < maxRows; i++)
-            {
-                SDL_FRect rowRect = {
-                    px,
-                    py + i * rowH,
-                    panel.w - 60.0f,
-                    rowH - 4.0f};
-                if (removeConfirmOpen && i == removeCandidateIdx)
-                {
-                    SDL_SetRenderDrawColor(renderer, 80, 40, 40, 255);
-                }
-                else
+                for (int i = 0; i < FIELD_COUNT; i++)
                 {
-                    SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+                    SDL_FRect box = ui.rects[WIDGET_FIELD + i];
+                    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+                    DrawText(renderer, panel.x + 30.0f, box.y, fields[i].label, 1.8f);
+
+                    if (i == activeField)
+                    {
+                        SDL_SetRenderDrawColor(renderer, 80, 80, 160, 255);
+                        SDL_RenderFillRect(renderer, &box);
+                        SDL_SetRenderDrawColor(renderer, 230, 230, 255, 255);
+                    }
+                    else
+                    {
+                        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+                        SDL_RenderFillRect(renderer, &box);
+                        SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
+                    }
+                    SDL_RenderRect(renderer, &box);
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    DrawText(renderer, box.x + 4, box.y + 5, fields[i].text, 1.8f);
                 }
-                SDL_RenderFillRect(renderer, &rowRect);
-                SDL_SetRenderDrawColor(renderer, 150, 150, 150, 255);
-                SDL_RenderRect(renderer, &rowRect);
+
+                SDL_FRect saveBtn = ui.rects[WIDGET_SAVE];
+                SDL_FRect cancelBtn = ui.rects[WIDGET_CANCEL];
+
+                SDL_SetRenderDrawColor(renderer, 40, 120, 40, 255);
+                SDL_RenderFillRect(renderer, &saveBtn);
+                SDL_SetRenderDrawColor(renderer, 220, 255, 220, 255);
+                SDL_RenderRect(renderer, &saveBtn);
                 SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                DrawText(renderer, rowRect.x + 10, rowRect.y + 6, planets[i].name, 2.0f);
-            }
+                DrawText(renderer, saveBtn.x + 40, saveBtn.y + 12, "SAVE", 2.0f);
 
-            SDL_FRect closeBtn = {
-                panel.x + panel.w - 180.0f,
-                panel.y + panel.h - 60.0f,
-                140.0f,
-                35.0f};
-            SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
-            SDL_RenderFillRect(renderer, &closeBtn);
-            SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
-            SDL_RenderRect(renderer, &closeBtn);
-            SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            DrawText(renderer, closeBtn.x + 20, closeBtn.y + 8, "CLOSE", 2.0f);
+                SDL_SetRenderDrawColor(renderer, 120, 40, 40, 255);
+                SDL_RenderFillRect(renderer, &cancelBtn);
+                SDL_SetRenderDrawColor(renderer, 255, 220, 220, 255);
+                SDL_RenderRect(renderer, &cancelBtn);
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawText(renderer, cancelBtn.x + 25, cancelBtn.y + 12, "CANCEL", 2.0f);
+            }
 
-            if (removeConfirmOpen && removeCandidateIdx >= 0 &&
-                removeCandidateIdx < numPlanets)
+            if (removePanelOpen)
             {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+                SDL_FRect overlay = {0, 0, (float)winW, (float)winH};
+                SDL_RenderFillRect(renderer, &overlay);
+
+                SDL_FRect panel = ui.rects[WIDGET_PANEL];
+                SDL_SetRenderDrawColor(renderer, 30, 30, 30, 240);
+                SDL_RenderFillRect(renderer, &panel);
+                SDL_SetRenderDrawColor(renderer, 220, 220, 220, 255);
+                SDL_RenderRect(renderer, &panel);
 
-                char buf[128];
-                snprintf(buf, sizeof(buf), "DELETE PLANET: %s ?", planets[removeCandidateIdx].name);
+                ListViewScrollTo(&removeList, removeList.scroll);
 
-                SDL_FRect confirmBox = {
-                    panel.x + 50.0f,
-                    panel.y + panel.h - 150.0f,
-                    panel.w - 100.0f,
-                    70.0f};
-                SDL_SetRenderDrawColor(renderer, 60, 30, 30, 255);
-                SDL_RenderFillRect(renderer, &confirmBox);
-                SDL_SetRenderDrawColor(renderer, 220, 200, 200, 255);
-                SDL_RenderRect(renderer, &confirmBox);
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawText(renderer, panel.x + 20, panel.y + 15, "REMOVE PLANET", 2.5f);
 
+                SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+                DrawText(renderer, panel.x + 30, panel.y + 61, "ORBIT", 1.8f);
+                DrawText(renderer, panel.x + 288, panel.y + 61, "TO", 1.8f);
+                const SDL_FRect *filterRects = &ui.rects[WIDGET_FILTER];
+                for (int i = 0; i < 3; i++)
+                {
+                    if (i == activeFilter)
+                    {
+                        SDL_SetRenderDrawColor(renderer, 80, 80, 160, 255);
+                        SDL_RenderFillRect(renderer, &filterRects[i]);
+                        SDL_SetRenderDrawColor(renderer, 230, 230, 255, 255);
+                    }
+                    else
+                    {
+                        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+                        SDL_RenderFillRect(renderer, &filterRects[i]);
+                        SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
+                    }
+                    SDL_RenderRect(renderer, &filterRects[i]);
+                    if (filterFields[i].text[0])
+                    {
+                        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                        DrawText(renderer, filterRects[i].x + 4, filterRects[i].y + 5, filterFields[i].text, 1.8f);
+                    }
+                    else
+                    {
+                        SDL_SetRenderDrawColor(renderer, 120, 120, 120, 255);
+                        DrawText(renderer, filterRects[i].x + 4, filterRects[i].y + 5, filterFields[i].label, 1.8f);
+                    }
+                }
+                SDL_FRect filterBtn = ui.rects[WIDGET_SELECT];
+                SDL_SetRenderDrawColor(renderer, 40, 40, 120, 255);
+                SDL_RenderFillRect(renderer, &filterBtn);
+                SDL_SetRenderDrawColor(renderer, 220, 220, 255, 255);
+                SDL_RenderRect(renderer, &filterBtn);
                 SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                DrawText(renderer, confirmBox.x + 15, confirmBox.y + 10, buf, 2.0f);
-
-                SDL_FRect yesBtn = {
-                    confirmBox.x + 40.0f,
-                    confirmBox.y + 30.0f,
-                    180.0f,
-                    30.0f};
-                SDL_FRect noBtn = {
-                    confirmBox.x + confirmBox.w - 220.0f,
-                    confirmBox.y + 30.0f,
-                    180.0f,
-                    30.0f};
+                DrawText(renderer, filterBtn.x + 30, filterBtn.y + 8, "SELECT", 2.0f);
 
+                SDL_FRect gotoBtn = ui.rects[WIDGET_GOTO];
                 SDL_SetRenderDrawColor(renderer, 40, 120, 40, 255);
-                SDL_RenderFillRect(renderer, &yesBtn);
+                SDL_RenderFillRect(renderer, &gotoBtn);
                 SDL_SetRenderDrawColor(renderer, 220, 255, 220, 255);
-                SDL_RenderRect(renderer, &yesBtn);
+                SDL_RenderRect(renderer, &gotoBtn);
                 SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                DrawText(renderer, yesBtn.x + 60, yesBtn.y + 6, "YES", 2.0f);
+                DrawText(renderer, gotoBtn.x + 25, gotoBtn.y + 8, "GO TO", 2.0f);
+
+                // only the rows inside the list area are drawn, however long the catalog
+                SDL_Rect clip = {
+                    (int)removeList.area.x,
+                    (int)removeList.area.y,
+                    (int)removeList.area.w + 1,
+                    (int)removeList.area.h};
+                SDL_SetRenderClipRect(renderer, &clip);
+                int endRow = ListViewEndVisible(&removeList);
+                for (int row = ListViewFirstVisible(&removeList); row < endRow; row++)
+                {
+                    int i = BodyRowIndex(&removeRows, &store, row);
+                    if (i < 0)
+                        continue;
+                    SDL_FRect rowRect = ListViewRowRect(&removeList, row);
+                    if (store.bodies[i].marked)
+                    {
+                        SDL_SetRenderDrawColor(renderer, 80, 40, 40, 255);
+                    }
+                    else
+                    {
+                        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+                    }
+                    SDL_RenderFillRect(renderer, &rowRect);
+                    SDL_SetRenderDrawColor(renderer, 150, 150, 150, 255);
+                    SDL_RenderRect(renderer, &rowRect);
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    DrawText(renderer, rowRect.x + 10, rowRect.y + 6, store.bodies[i].name, 2.0f);
+                }
+                SDL_SetRenderClipRect(renderer, NULL);
 
+                SDL_FRect listTrack = ui.rects[WIDGET_LIST_TRACK];
+                SDL_FRect listThumb = ListViewScrollbarThumb(&removeList);
+                SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+                SDL_RenderFillRect(renderer, &listTrack);
+                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                SDL_RenderFillRect(renderer, &listThumb);
+
+                SDL_FRect deleteBtn = ui.rects[WIDGET_DELETE];
                 SDL_SetRenderDrawColor(renderer, 120, 40, 40, 255);
-                SDL_RenderFillRect(renderer, &noBtn);
+                SDL_RenderFillRect(renderer, &deleteBtn);
                 SDL_SetRenderDrawColor(renderer, 255, 220, 220, 255);
-                SDL_RenderRect(renderer, &noBtn);
+                SDL_RenderRect(renderer, &deleteBtn);
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawText(renderer, deleteBtn.x + 20, deleteBtn.y + 8, "DELETE SELECTED", 2.0f);
+
+                char markedText[32];
+                snprintf(markedText, sizeof(markedText), "%d SELECTED", removeMarked);
+                SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+                DrawText(renderer, panel.x + 340, panel.y + panel.h - 50, markedText, 1.8f);
+
+                SDL_FRect closeBtn = ui.rects[WIDGET_CLOSE];
+                SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
+                SDL_RenderFillRect(renderer, &closeBtn);
+                SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+                SDL_RenderRect(renderer, &closeBtn);
+                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                DrawText(renderer, closeBtn.x + 20, closeBtn.y + 8, "CLOSE", 2.0f);
+
+                if (removeConfirmOpen)
+                {
+                    char buf[128];
+                    if (removeConfirmCount == 1)
+                    {
+                        const char *name = "";
+                        for (int i = 0; i < store.count; i++)
+                        {
+                            if (store.bodies[i].marked)
+                            {
+                                name = store.bodies[i].name;
+                                break;
+                            }
+                        }
+                        snprintf(buf, sizeof(buf), "DELETE PLANET: %s ?", name);
+                    }
+                    else
+                    {
+                        snprintf(buf, sizeof(buf), "DELETE %d PLANETS ?", removeConfirmCount);
+                    }
+
+                    SDL_FRect confirmBox = ui.rects[WIDGET_CONFIRM];
+                    SDL_SetRenderDrawColor(renderer, 60, 30, 30, 255);
+                    SDL_RenderFillRect(renderer, &confirmBox);
+                    SDL_SetRenderDrawColor(renderer, 220, 200, 200, 255);
+                    SDL_RenderRect(renderer, &confirmBox);
+
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    DrawText(renderer, confirmBox.x + 15, confirmBox.y + 10, buf, 2.0f);
+
+                    SDL_FRect yesBtn = ui.rects[WIDGET_YES];
+                    SDL_FRect noBtn = ui.rects[WIDGET_NO];
+
+                    SDL_SetRenderDrawColor(renderer, 40, 120, 40, 255);
+                    SDL_RenderFillRect(renderer, &yesBtn);
+                    SDL_SetRenderDrawColor(renderer, 220, 255, 220, 255);
+                    SDL_RenderRect(renderer, &yesBtn);
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    DrawText(renderer, yesBtn.x + 60, yesBtn.y + 6, "YES", 2.0f);
+
+                    SDL_SetRenderDrawColor(renderer, 120, 40, 40, 255);
+                    SDL_RenderFillRect(renderer, &noBtn);
+                    SDL_SetRenderDrawColor(renderer, 255, 220, 220, 255);
+                    SDL_RenderRect(renderer, &noBtn);
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    DrawText(renderer, noBtn.x + 65, noBtn.y + 6, "NO", 2.0f);
+                }
+            }
+
+            if (toTexture)
+            {
+                SDL_SetRenderTarget(renderer, NULL);
+                uiDirty = false;
+            }
+        }
+        if (uiTexture && !uiDirty)
+            SDL_RenderTexture(renderer, uiTexture, NULL, NULL);
+
+        if (!addPanelOpen && !removePanelOpen && hovered.kind != PICK_NONE)
+        {
+            char tip[TEXT_RUN_MAX] = "";
+            if (hovered.kind == PICK_PLANET)
+            {
+                Planet *p = BodyStoreGet(&store, hovered.planet);
+                if (p)
+                    snprintf(tip, sizeof(tip), "%s\nORBIT %.1f\nSPEED %.4f\nPARENT SUN",
+                             p->name, p->orbitRadius, p->angularSpeed);
+            }
+            else if (hovered.kind == PICK_MOON)
+            {
+                struct Moon *m = &moons[hovered.index];
+                Planet *parent = BodyStoreGet(&store, m->parent);
+                if (parent)
+                    snprintf(tip, sizeof(tip), "MOON %d\nORBIT %.1f\nSPEED %.4f\nPARENT %s",
+                             hovered.index + 1, m->orbitRadius, m->angularSpeed, parent->name);
+            }
+            else if (hovered.kind == PICK_ASTEROID)
+            {
+                snprintf(tip, sizeof(tip), "ASTEROID %d\nORBIT %.1f\nSPEED %.4f\nPARENT SUN",
+                         hovered.index + 1, asteroid_radius[hovered.index], asteroid_speed[hovered.index]);
+            }
+            if (tip[0] && TextRunSet(&tooltip, tip, 1.8f))
+            {
+                SDL_FRect box = {
+                    lastX + 16.0f,
+                    lastY + 16.0f,
+                    tooltip.width + 16.0f,
+                    tooltip.height + 16.0f};
+                if (box.x + box.w > winW)
+                    box.x = lastX - 8.0f - box.w;
+                if (box.y + box.h > winH)
+                    box.y = lastY - 8.0f - box.h;
+                SDL_SetRenderDrawColor(renderer, 20, 20, 40, 230);
+                SDL_RenderFillRect(renderer, &box);
+                SDL_SetRenderDrawColor(renderer, 180, 180, 220, 255);
+                SDL_RenderRect(renderer, &box);
                 SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-                DrawText(renderer, noBtn.x + 65, noBtn.y + 6, "NO", 2.0f);
+                DrawTextRun(renderer, &tooltip, box.x + 8.0f, box.y + 8.0f);
             }
         }
 
+#ifdef SOLAR_PROFILE
+        if (hud.visible)
+            DrawPerfHud(renderer, &hud, winW);
+#endif
+        PROFILE_END(STAGE_UI);
+
+        PROFILE_BEGIN(STAGE_PRESENT);
         SDL_RenderPresent(renderer);
+        PROFILE_END(STAGE_PRESENT);
+        PROFILE_FRAME_END();
+        HitchFrameEnd();
+        MetricsFrameEnd(store.count);
+        if (bench)
+        {
+            if (simTicks >= BENCH_WARMUP_FRAMES + BENCH_FRAMES)
+                running = 0;
+            continue;
+        }
+        PROFILE_REPORT();
         SDL_Delay(16);
     }
 
-    free(planets);
+    // a bench that stopped early has no report to give
+    if (bench && simTicks < BENCH_WARMUP_FRAMES + BENCH_FRAMES)
+        status = 1;
+#ifdef SOLAR_PROFILE
+    if (bench && status == 0)
+        BenchReport(bench, store.count, WIDTH, HEIGHT);
+#endif
+
+    CatalogWatcherStop(&watcher);
+    PagedLoaderStop(&pager, &store);
+    CatalogClose(&catalog);
+    MetricsStop();
+    TRACE_STOP();
+    NameIndexFree(&names);
+    PickGridFree(&pickGrid);
+    TextRunFree(&tooltip);
+#ifdef SOLAR_PROFILE
+    PerfHudFree(&hud);
+    HwCountersStop();
+#endif
+    if (uiTexture)
+        SDL_DestroyTexture(uiTexture);
+    if (sceneTexture)
+        SDL_DestroyTexture(sceneTexture);
+    BodyStoreFree(&store);
+    free(sceneArrays);
     SDL_DestroyRenderer(renderer);
+    SDL_DestroySurface(benchSurface);
     SDL_DestroyWindow(window);
     SDL_Quit();
-    return 0;
+    return status;
 }
+#endif